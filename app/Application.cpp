@@ -4,6 +4,8 @@
 #include <QMenu>
 
 #include "../ipc/dbus/flowshotdbusadapter.h"
+#include "../uploader/UploadJournal.h"
+#include "../uploader/UploadNetwork.h"
 #include "../utils/clipboard.h"
 #include "../utils/ConfigHandler.h"
 #include "../utils/abstractlogger.h"
@@ -15,6 +17,8 @@ namespace Flowshot
     void Application::init(bool noTray)
     {
         ConfigHandler::getInstance()->checkImport();
+        // Have a connection ready by the time the first upload starts
+        UploadNetwork::instance()->prewarm();
         Clipboard::start();
         if (!noTray)
         {
@@ -57,6 +61,10 @@ namespace Flowshot
                 AbstractLogger::error() << "Error registering DBus object.";
             }
 #endif
+
+            // Finish uploads a previous run didn't get to
+            UploadJournal::instance()->drain();
+            UploadNetwork::instance()->setKeepWarm(true);
         }
 
 
@@ -77,4 +85,14 @@ namespace Flowshot
     {
         m_screenshotManager->uploadFile(path, false);
     }
+
+    void Application::uploadFiles(const QStringList& paths) const
+    {
+        m_screenshotManager->uploadFiles(paths);
+    }
+
+    bool Application::cancelUpload(const QString& jobId) const
+    {
+        return m_screenshotManager->cancelUpload(jobId);
+    }
 }
@@ -21,6 +21,8 @@ public:
     void init(bool noTray);
     void takeScreenshot() const;
     void uploadFile(QString path) const;
+    void uploadFiles(const QStringList& paths) const;
+    bool cancelUpload(const QString& jobId) const;
 
     signals:
         void ready();
@@ -4,18 +4,32 @@
 
 #include "ScreenshotManager.h"
 
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QMimeDatabase>
 #include <QNetworkAccessManager>
+#include <QSharedPointer>
 #include <QTimer>
+#include <optional>
 
 #include "Application.h"
+#include "../uploader/ApiEndpointPool.h"
+#include "../uploader/UploadJournal.h"
+#include "../uploader/UploadNetwork.h"
+#include "../uploader/UploadScheduler.h"
+#include "../uploader/privateuploader/PrivateUploaderBatchUpload.h"
+#include "../utils/Awaitables.h"
+#include "../utils/filenamehandler.h"
 #include "../utils/clipboard.h"
 #include "../utils/abstractlogger.h"
 
 namespace Flowshot
 {
-    void ScreenshotManager::takeScreenshot(ScreenshotUtility util)
+    Task<> ScreenshotManager::takeScreenshot(ScreenshotUtility util)
     {
-        if (m_isTakingScreenshot) return;
+        if (m_isTakingScreenshot) co_return;
         m_isTakingScreenshot = true;
 
         QString program;
@@ -29,106 +43,294 @@ namespace Flowshot
 
         QString filePath = randomFilePath();
 
-        QProcess* process = new QProcess(this);
+        // Connect while the user is still selecting a region
+        UploadNetwork::instance()->prewarm();
 
-        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-                this, [this, filePath, process](int, QProcess::ExitStatus)
-                {
-                    m_isTakingScreenshot = false;
-                    process->deleteLater();
-                    uploadFile(filePath, true);
-                });
+        {
+            QProcess process;
+            process.start(program, QStringList() << "-ncrb" << "-o" << filePath);
+            co_await awaitProcess(&process);
+        }
+        m_isTakingScreenshot = false;
 
-        process->start(program, QStringList() << "-ncrb" << "-o" << filePath);
+        co_await uploadFile(filePath, true);
     }
 
-    void ScreenshotManager::uploadFile(const QString& filePath, bool fromScreenshotUtility = false)
+    /**
+     * Capture -> upload -> clipboard, one window per file. The preview is
+     * decoded on the thread pool while the file uploads.
+     */
+    Task<> ScreenshotManager::uploadFile(QString filePath, bool fromScreenshotUtility)
     {
-        if (QFile::exists(filePath))
+        if (!QFile::exists(filePath))
         {
-            // QPixmap pixmap(filePath);
-            // if (!pixmap.isNull())
+            AbstractLogger::warning() << "Screenshot file does not exist:" << filePath;
+            co_return;
+        }
+
+        QString jobId = UploadJournal::instance()->enqueue(filePath, fromScreenshotUtility);
+        ImgUploaderManager* uploaderManager = new ImgUploaderManager(m_NetworkAM);
+        QPointer<ImgUploaderBase> widget = uploaderManager->uploader(filePath, fromScreenshotUtility);
+
+        m_openWindowCount++;
+        m_uploads.insert(jobId, widget);
+
+        QObject::connect(
+            widget, &QObject::destroyed, this, [this, jobId]() {
+                m_openWindowCount--;
+                m_uploads.remove(jobId);
+            });
+
+        if (ConfigHandler().uploadWindowEnabled())
+        {
+            widget->show();
+        }
+
+        widget->showPreUploadDialog(m_openWindowCount);
+        QObject::connect(
+            widget, &ImgUploaderBase::uploadProgress, [=](int progress, double speed, int etaSeconds)
+            {
+                widget->updateProgress(progress, speed, etaSeconds);
+            });
+        // The first progress report means the bytes are on the wire
+        QObject::connect(
+            widget, &ImgUploaderBase::uploadProgress, this, [jobId]()
             {
-                ImgUploaderManager* uploaderManager = new ImgUploaderManager(m_NetworkAM);
-                ImgUploaderBase* widget = uploaderManager->uploader(filePath, fromScreenshotUtility);
+                UploadJournal::instance()->markStarted(jobId);
+            }, Qt::SingleShotConnection);
 
-                m_openWindowCount++;
+        QObject::connect(
+            widget, &ImgUploaderBase::uploadError, [=](QNetworkReply* error)
+            {
+                widget->showErrorUploadDialog(error);
+            });
+
+        // Emitted before dialogClosed, whose release() is a no-op after the drop
+        QObject::connect(
+            widget, &ImgUploaderBase::uploadCancelled, this, [this, filePath, fromScreenshotUtility, jobId]()
+            {
+                m_uploads.remove(jobId);
+                UploadJournal::instance()->drop(jobId);
+                if (fromScreenshotUtility && QFile::remove(filePath))
+                {
+                    AbstractLogger::info() << "Upload cancelled, file deleted at: " << filePath;
+                }
+            });
 
-                QObject::connect(
-                    widget, &QObject::destroyed, [this]() { m_openWindowCount--; });
+        emit screenshotUploaded(filePath);
 
-                if (ConfigHandler().uploadWindowEnabled())
+        std::optional<Task<QImage>> thumbnail;
+        if (fromScreenshotUtility && ConfigHandler().uploadWindowEnabled() && ConfigHandler().uploadWindowImageEnabled())
+        {
+            thumbnail.emplace(runInPool([filePath]()
+            {
+                QImageReader reader(filePath);
+                reader.setAutoTransform(true);
+                QSize scaledSize = reader.size();
+                scaledSize.scale(QSize(512, 512), Qt::KeepAspectRatio);
+                reader.setScaledSize(scaledSize);
+                return reader.read();
+            }));
+        }
+
+        auto uploaded = co_await awaitSignal(widget.data(), &ImgUploaderBase::uploadFinished);
+        QUrl url = uploaded ? std::get<0>(*uploaded) : QUrl();
+        if (!url.isEmpty())
+        {
+            m_uploads.remove(jobId);
+            UploadJournal::instance()->markDone(jobId, url.toString());
+
+            if (thumbnail)
+            {
+                QImage image = co_await *thumbnail;
+                if (widget && !image.isNull())
                 {
-                    widget->show();
+                    widget->setPixmap(QPixmap::fromImage(image));
                 }
+            }
 
-                // NOTE: lambda can't capture 'this' because it might be destroyed later
-                widget->showPreUploadDialog(m_openWindowCount);
-                QObject::connect(
-                    widget, &ImgUploaderBase::uploadOk, [=, this](const QUrl& url)
-                    {
-                        if (ConfigHandler().copyURLAfterUpload())
-                        {
-                            // I dunno why this works, because shouldn't it be on the main thread already
-                            QObject* receiver = qApp;
-                            QMetaObject::invokeMethod(receiver, [url]() {
-                                if (ConfigHandler().copyURLAfterUpload()) {
-                                    Clipboard::copyToClipboard(url.toString(), url.toString());
-                                }
-                            }, Qt::QueuedConnection);
-                            widget->showPostUploadDialog(m_openWindowCount);
-
-                            // Disconnect all signals after upload completes
-                            disconnect(widget, &ImgUploaderBase::uploadProgress, nullptr, nullptr);
-                            disconnect(widget, &ImgUploaderBase::uploadError, nullptr, nullptr);
-                        }
-                    });
-                QObject::connect(
-                    widget, &ImgUploaderBase::uploadProgress, [=](int progress, double speed)
-                    {
-                        widget->updateProgress(progress, speed);
-                    });
-
-                QObject::connect(
-                    widget, &ImgUploaderBase::uploadError, [=](QNetworkReply* error)
-                    {
-                        widget->showErrorUploadDialog(error);
-                    });
-
-                QObject::connect(
-                    widget, &ImgUploaderBase::dialogClosed, [this, filePath, fromScreenshotUtility](bool success)
-                    {
-                        if (!filePath.data() || filePath == "") return;
-                        // Do not delete files that aren't in the /tmp folder from the screenshot utility
-                        if (QFile::exists(filePath) && fromScreenshotUtility)
-                        {
-                            if (QFile::remove(filePath))
-                            {
-                                AbstractLogger::info() << "File deleted at: " << filePath;
-                            }
-                            else
-                            {
-                                AbstractLogger::warning() << "File failed to delete: " << filePath;
-                            }
-                        }
-                        else if (fromScreenshotUtility)
-                        {
-                            AbstractLogger::warning() << "File doesn't exist: " << filePath;
-                        }
-
-                        emit dialogClosed();
-                    });
-
-
-                emit screenshotUploaded(filePath);
+            if (widget && ConfigHandler().copyURLAfterUpload())
+            {
+                // I dunno why this works, because shouldn't it be on the main thread already
+                QObject* receiver = qApp;
+                QMetaObject::invokeMethod(receiver, [url]() {
+                    if (ConfigHandler().copyURLAfterUpload()) {
+                        Clipboard::copyToClipboard(url.toString(), url.toString());
+                    }
+                }, Qt::QueuedConnection);
+                widget->showPostUploadDialog(m_openWindowCount);
+
+                // Disconnect all signals after upload completes
+                disconnect(widget, &ImgUploaderBase::uploadProgress, nullptr, nullptr);
+                disconnect(widget, &ImgUploaderBase::uploadError, nullptr, nullptr);
             }
-            // {
-            // AbstractLogger::warning() << "Failed to load screenshot pixmap:" << filePath;
-            // }
         }
-        else
+
+        // Without a visible window there is nothing to wait for
+        bool success = !url.isEmpty();
+        if (widget && widget->isVisible())
         {
-            AbstractLogger::warning() << "Screenshot file does not exist:" << filePath;
+            auto closed = co_await awaitSignal(widget.data(), &ImgUploaderBase::dialogClosed);
+            if (closed)
+            {
+                success = std::get<0>(*closed);
+            }
+        }
+
+        if (!success)
+        {
+            // A window that was never shown isn't closed by anyone
+            if (widget && !widget->isVisible())
+            {
+                widget->deleteLater();
+            }
+            // Keep the capture around, the journal uploads it later
+            UploadJournal::instance()->release(jobId);
+            emit dialogClosed();
+            co_return;
+        }
+        // Do not delete files that aren't in the /tmp folder from the screenshot utility
+        if (QFile::exists(filePath) && fromScreenshotUtility)
+        {
+            if (QFile::remove(filePath))
+            {
+                AbstractLogger::info() << "File deleted at: " << filePath;
+            }
+            else
+            {
+                AbstractLogger::warning() << "File failed to delete: " << filePath;
+            }
+        }
+        else if (fromScreenshotUtility)
+        {
+            AbstractLogger::warning() << "File doesn't exist: " << filePath;
+        }
+
+        emit dialogClosed();
+    }
+
+    bool ScreenshotManager::cancelUpload(const QString& jobId)
+    {
+        if (QPointer<ImgUploaderBase> widget = m_uploads.value(jobId))
+        {
+            widget->cancel();
+            return true;
+        }
+        // Queued for the background drain, or left behind by a previous run
+        return UploadJournal::instance()->cancel(jobId);
+    }
+
+    void ScreenshotManager::uploadFiles(const QStringList& filePaths)
+    {
+        struct Batch
+        {
+            int remaining = 0;
+            QHash<QString, QString> jobs; // file path -> journal id
+            QStringList urls;
+        };
+        auto batch = QSharedPointer<Batch>::create();
+        ImgUploaderManager* uploaderManager = new ImgUploaderManager(this);
+
+        auto fileDone = [this, batch, uploaderManager](const QString& filePath, const QString& url, const QString& error)
+        {
+            QString jobId = batch->jobs.value(filePath);
+            if (url.isEmpty())
+            {
+                AbstractLogger::warning() << QStringLiteral("Failed to upload %1: %2").arg(filePath, error);
+                // Keep it, the journal uploads it later
+                UploadJournal::instance()->release(jobId);
+            }
+            else
+            {
+                AbstractLogger::info() << QStringLiteral("%1: %2").arg(filePath, url);
+                UploadJournal::instance()->markDone(jobId, url);
+                batch->urls.append(url);
+            }
+
+            if (--batch->remaining > 0) return;
+            if (ConfigHandler().copyURLAfterUpload() && !batch->urls.isEmpty())
+            {
+                Clipboard::copyToClipboard(batch->urls.join(QLatin1Char('\n')));
+            }
+            uploaderManager->deleteLater();
+            emit dialogClosed();
+        };
+
+        auto uploadAlone = [this, uploaderManager, fileDone](const QString& filePath)
+        {
+            uploaderManager->uploadInBackground(filePath, this, [filePath, fileDone](const QUrl& url, const QString& error) {
+                fileDone(filePath, url.toString(), error);
+            });
+        };
+
+        auto uploadTogether = [this, batch, fileDone, uploadAlone](const QList<PrivateUploaderBatchUpload::File>& files, qint64 size)
+        {
+            auto* worker = new PrivateUploaderBatchUpload(UploadNetwork::instance()->networkAccessManager());
+            worker->moveToThread(UploadNetwork::instance()->thread());
+            connect(worker, &PrivateUploaderBatchUpload::uploadProgress, this, [batch, files]() {
+                for (const PrivateUploaderBatchUpload::File& file : files) UploadJournal::instance()->markStarted(batch->jobs.value(file.filePath));
+            }, Qt::SingleShotConnection);
+            connect(worker, &PrivateUploaderBatchUpload::fileUploaded, this, [fileDone](FlowinityValidUploadResponse response) {
+                fileDone(response.getFilePath(), response.getUrl(), {});
+            });
+            connect(worker, &PrivateUploaderBatchUpload::fileFailed, this, [fileDone](const QString& filePath, const QString& error) {
+                fileDone(filePath, {}, error);
+            });
+            connect(worker, &PrivateUploaderBatchUpload::batchUnsupported, this, [uploadAlone](const QStringList& filePaths) {
+                for (const QString& filePath : filePaths) uploadAlone(filePath);
+            });
+            connect(worker, &PrivateUploaderBatchUpload::uploadFinished, worker, &QObject::deleteLater);
+            UploadScheduler::instance()->submit(worker, [worker, files]() {
+                worker->uploadFiles(files);
+            }, UploadPriority::Bulk, size, QUrl(ApiEndpointPool::instance()->preferred()));
+        };
+
+        // Only the Flowinity API takes several files per request. A batch
+        // posts the files as they are, encrypted files go one at a time
+        // through the upload that encrypts them.
+        ConfigHandler config;
+        bool batching = uploaderManager->uploaderPlugin() == QLatin1String("privateuploader")
+                        && !config.uploadEncrypt();
+        qint64 maxBytes = qint64(config.uploadBatchMaxSize()) * 1024;
+        int maxFiles = config.uploadBatchMaxFiles();
+
+        QList<PrivateUploaderBatchUpload::File> files;
+        qint64 filesSize = 0;
+        QStringList alone;
+        for (const QString& filePath : filePaths)
+        {
+            if (!QFile::exists(filePath) || batch->jobs.contains(filePath))
+            {
+                AbstractLogger::warning() << "File does not exist or is listed twice:" << filePath;
+                continue;
+            }
+            batch->jobs.insert(filePath, UploadJournal::instance()->enqueue(filePath, false));
+            ++batch->remaining;
+
+            qint64 size = QFileInfo(filePath).size();
+            if (!batching || size > maxBytes)
+            {
+                alone.append(filePath);
+                continue;
+            }
+            if (!files.isEmpty() && (files.size() >= maxFiles || filesSize + size > maxBytes))
+            {
+                uploadTogether(files, filesSize);
+                files.clear();
+                filesSize = 0;
+            }
+            files.append({ filePath,
+                           FileNameHandler().parseFilename(QFileInfo(filePath).fileName()),
+                           QMimeDatabase().mimeTypeForFile(filePath).name() });
+            filesSize += size;
+        }
+        if (!files.isEmpty()) uploadTogether(files, filesSize);
+        for (const QString& filePath : std::as_const(alone)) uploadAlone(filePath);
+
+        if (batch->remaining == 0)
+        {
+            uploaderManager->deleteLater();
+            emit dialogClosed();
         }
     }
 } // Flowshot
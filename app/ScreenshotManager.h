@@ -8,9 +8,12 @@
 #include <QProcess>
 #include "../utils/rng.h"
 #include <QFile>
+#include <QHash>
 #include <QNetworkAccessManager>
+#include <QPointer>
 
 #include "../uploader/imguploadermanager.h"
+#include "../utils/Task.h"
 #include <qpixmap.h>
 
 namespace Flowshot {
@@ -28,6 +31,8 @@ namespace Flowshot {
         int m_openWindowCount = 0;
         bool m_isTakingScreenshot = false;
         QNetworkAccessManager* m_NetworkAM;
+        // Upload windows by journal job id, while they are uploading
+        QHash<QString, QPointer<ImgUploaderBase>> m_uploads;
 
     public:
         explicit ScreenshotManager(QObject* parent = nullptr) : QObject(parent)
@@ -35,8 +40,13 @@ namespace Flowshot {
             m_NetworkAM = new QNetworkAccessManager(this);
         }
 
-        void takeScreenshot(ScreenshotUtility util);
-        void uploadFile(const QString& filePath, bool fromScreenshotUtility);
+        // Both run until the upload window is closed, the result can be dropped
+        Task<> takeScreenshot(ScreenshotUtility util);
+        Task<> uploadFile(QString filePath, bool fromScreenshotUtility);
+        // Without windows; small files share requests. dialogClosed() follows the last one.
+        void uploadFiles(const QStringList& filePaths);
+        // Cancel an upload by journal job id, false if there is no such pending upload
+        bool cancelUpload(const QString& jobId);
 
     signals:
         void screenshotTaken(const QString &filePath);
@@ -1,6 +1,9 @@
 #include "flowshotdbusadapter.h"
 #include "../../app/Application.h"  // or whatever header defines Application
 #include <QDateTime>
+#include <QJsonDocument>
+#include "../../uploader/UploadJournal.h"
+#include "../../uploader/UploadTimings.h"
 #include "../../utils/abstractlogger.h"
 
 FlowshotDbusAdapter::FlowshotDbusAdapter(QObject* parent)
@@ -35,6 +38,31 @@ void FlowshotDbusAdapter::uploadFile(const QString& path)
     }
 }
 
+void FlowshotDbusAdapter::uploadFiles(const QStringList& paths)
+{
+    if (auto app = qobject_cast<Flowshot::Application*>(parent())) {
+        app->uploadFiles(paths);
+    }
+}
+
 void FlowshotDbusAdapter::checkIfRunning() {
     //
-}
\ No newline at end of file
+}
+
+bool FlowshotDbusAdapter::cancelUpload(const QString& id)
+{
+    if (auto app = qobject_cast<Flowshot::Application*>(parent())) {
+        return app->cancelUpload(id);
+    }
+    return false;
+}
+
+QString FlowshotDbusAdapter::pendingUploads()
+{
+    return QString::fromUtf8(QJsonDocument(UploadJournal::instance()->pending()).toJson(QJsonDocument::Compact));
+}
+
+QString FlowshotDbusAdapter::uploadTimings(const QString& endpoint)
+{
+    return QString::fromUtf8(QJsonDocument(UploadTimingLog::instance()->recent(endpoint)).toJson(QJsonDocument::Compact));
+}
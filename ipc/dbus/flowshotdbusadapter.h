@@ -18,6 +18,14 @@ public:
 public slots:
     Q_NOREPLY void captureScreen(const QString& captureMode);
     Q_NOREPLY void uploadFile(const QString& path);
+    // Several files at once, small ones share requests
+    Q_NOREPLY void uploadFiles(const QStringList& paths);
     Q_NOREPLY void checkIfRunning();
+    // Cancel a pending upload by its job id, see pendingUploads()
+    bool cancelUpload(const QString& id);
+    // JSON array of unfinished uploads: {id, path, attempts, state}
+    QString pendingUploads();
+    // JSON array of recent upload timings, all endpoints if `endpoint` is empty
+    QString uploadTimings(const QString& endpoint);
     // Q_NOREPLY void compressAndUploadFolder(const QString& path);
 };
@@ -5,6 +5,7 @@
 #include <QFileInfo>
 #include <QDBusConnection>
 #include <QDBusMessage>
+#include <QTextStream>
 #include "app/Application.h"
 #include "app/ScreenshotManager.h"
 #include "app/pages/settings/configEntry.h"
@@ -29,6 +30,25 @@ bool sendFlowshotDbusCommand(QString method, const QVariantList &args = {}) {
 #endif
 }
 
+QString queryFlowshotDbus(const QString& method, const QVariantList& args = {}) {
+#if !(defined(Q_OS_MACOS) || defined(Q_OS_WIN))
+    QDBusConnection connection = QDBusConnection::sessionBus();
+    if (!connection.isConnected()) return {};
+
+    QDBusMessage msg = QDBusMessage::createMethodCall(
+        "com.flowinity.flowshot2", "/", "com.flowinity.flowshot2", method
+    );
+
+    for (const QVariant &arg : args) msg << arg;
+
+    QDBusMessage reply = connection.call(msg);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) return {};
+    return reply.arguments().first().toString();
+#else
+    return {};
+#endif
+}
+
 int main(int argc, char **argv) {
     bool platformSet = false;
     for (int i = 1; i < argc; ++i) {
@@ -53,9 +73,12 @@ int main(int argc, char **argv) {
     QCommandLineParser parser;
     parser.setApplicationDescription("Flowshot2 help");
     parser.addHelpOption();
-    parser.addPositionalArgument("up", "up {file} - Upload a file to Flowinity.");
+    parser.addPositionalArgument("up", "up {file...} - Upload files to Flowinity.");
     parser.addPositionalArgument("config", "Open the Flowshot Configuration menu.");
     parser.addPositionalArgument("gui", "Quickly take a screenshot.");
+    parser.addPositionalArgument("timings", "timings [endpoint] - Print recent upload timings of the running service as JSON.");
+    parser.addPositionalArgument("pending", "Print the unfinished uploads of the running service as JSON.");
+    parser.addPositionalArgument("cancel", "cancel {id} - Cancel a pending upload of the running service.");
     parser.addPositionalArgument("{file}", "Alias for up {file}. Upload a file to Flowinity.");
     parser.addPositionalArgument("[none]", "Run the Flowshot system tray service.");
 
@@ -82,6 +105,33 @@ int main(int argc, char **argv) {
         flowshotApp.takeScreenshot();
         QObject::connect(&flowshotApp, &Flowshot::Application::dialogClosed, &QCoreApplication::quit);
         return app.exec();
+    } else if (command == "timings") {
+        QString timings = queryFlowshotDbus("uploadTimings", {args.size() > 1 ? args.at(1) : QString()});
+        if (timings.isNull()) {
+            AbstractLogger::error() << "Flowshot service is not running.";
+            return 1;
+        }
+        QTextStream(stdout) << timings << Qt::endl;
+        return 0;
+    } else if (command == "pending") {
+        QString pending = queryFlowshotDbus("pendingUploads");
+        if (pending.isNull()) {
+            AbstractLogger::error() << "Flowshot service is not running.";
+            return 1;
+        }
+        QTextStream(stdout) << pending << Qt::endl;
+        return 0;
+    } else if (command == "cancel" && args.size() > 1) {
+        QString cancelled = queryFlowshotDbus("cancelUpload", {args.at(1)});
+        if (cancelled.isNull()) {
+            AbstractLogger::error() << "Flowshot service is not running.";
+            return 1;
+        }
+        if (cancelled != QLatin1String("true")) {
+            AbstractLogger::error() << "No pending upload with id" << args.at(1);
+            return 1;
+        }
+        return 0;
     } else if (command == "config") {
         ConfigEntry* settingsWindow = new ConfigEntry();
         settingsWindow->show();
@@ -90,6 +140,27 @@ int main(int argc, char **argv) {
         return app.exec();
     }
 
+    // Several files are uploaded in the background, small ones several per request
+    if (command == "up" && args.size() > 2) {
+        QStringList filePaths;
+        for (const QString& arg : args.mid(1)) {
+            QString path = QFileInfo(QDir::current(), arg).absoluteFilePath();
+            if (!QFile::exists(path)) {
+                AbstractLogger::error() << "File does not exist:" << path;
+                return 1;
+            }
+            filePaths.append(path);
+        }
+
+        if (sendFlowshotDbusCommand("uploadFiles", {filePaths})) return 0;
+
+        Flowshot::Application flowshotApp;
+        flowshotApp.init(true);
+        flowshotApp.uploadFiles(filePaths);
+        QObject::connect(&flowshotApp, &Flowshot::Application::dialogClosed, &QCoreApplication::quit);
+        return app.exec();
+    }
+
     QString filePath;
     if (command == "up" && args.size() > 1) {
         filePath = args.at(1);
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "ApiEndpointPool.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QUrl>
+
+#include "UploadNetwork.h"
+#include "../utils/ConfigHandler.h"
+#include "../utils/abstractlogger.h"
+
+static constexpr int POOL_PROBE_INTERVAL_MS = 30 * 1000;
+static constexpr int POOL_PROBE_TIMEOUT_MS = 5000;
+// Weight of the newest sample in the smoothed values
+static constexpr double POOL_RTT_ALPHA = 0.3;
+static constexpr double POOL_ERROR_ALPHA = 0.2;
+// Nodes at or above this error rate get no traffic while others are healthy
+static constexpr double POOL_UNHEALTHY_ERROR_RATE = 0.5;
+// Assumed for nodes that haven't been probed yet
+static constexpr double POOL_UNKNOWN_RTT_MS = 200;
+// Keeps a node on a very fast link from taking every request
+static constexpr double POOL_MIN_RTT_MS = 5;
+
+ApiEndpointPool::ApiEndpointPool()
+  : QObject(nullptr)
+  , m_probeTimer(new QTimer(this))
+{
+    moveToThread(UploadNetwork::instance()->thread());
+
+    m_probeTimer->setInterval(POOL_PROBE_INTERVAL_MS);
+    connect(m_probeTimer, &QTimer::timeout, this, &ApiEndpointPool::probe);
+
+    reloadConfig();
+    connect(ConfigHandler::getInstance(), &ConfigHandler::fileChanged, this, &ApiEndpointPool::reloadConfig);
+}
+
+ApiEndpointPool* ApiEndpointPool::instance()
+{
+    static ApiEndpointPool* pool = new ApiEndpointPool();
+    return pool;
+}
+
+void ApiEndpointPool::reloadConfig()
+{
+    ConfigHandler config;
+    QStringList urls = config.serverAPIEndpointList().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (urls.isEmpty()) {
+        urls.append(config.serverAPIEndpoint());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QStringList previous;
+    for (const Node& node : std::as_const(m_nodes)) {
+        previous.append(node.url);
+    }
+    QList<Node> nodes;
+    for (const QString& url : urls) {
+        Node node;
+        node.url = url;
+        // Keep what was learned about nodes that are still listed
+        for (const Node& known : std::as_const(m_nodes)) {
+            if (known.url == url) {
+                node = known;
+            }
+        }
+        nodes.append(node);
+    }
+    m_nodes = nodes;
+    locker.unlock();
+
+    if (urls != previous) {
+        AbstractLogger::info() << QStringLiteral("API endpoints: %1").arg(urls.join(QStringLiteral(", ")));
+    }
+
+    // A single node has nothing to be balanced against
+    QMetaObject::invokeMethod(this, [this, multiple = urls.size() > 1]() {
+        if (multiple && !m_probeTimer->isActive()) {
+            m_probeTimer->start();
+            probe();
+        } else if (!multiple) {
+            m_probeTimer->stop();
+        }
+    }, Qt::QueuedConnection);
+}
+
+double ApiEndpointPool::weight(const Node& node)
+{
+    double rtt = node.rttMs >= 0 ? qMax(node.rttMs, POOL_MIN_RTT_MS) : POOL_UNKNOWN_RTT_MS;
+    double health = 1.0 - node.errorRate;
+    return health * health / rtt;
+}
+
+QString ApiEndpointPool::pick() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    double total = 0;
+    for (const Node& node : m_nodes) {
+        if (node.errorRate < POOL_UNHEALTHY_ERROR_RATE) {
+            total += weight(node);
+        }
+    }
+    if (total <= 0) {
+        const Node* node = best();
+        return node ? node->url : QString();
+    }
+
+    double target = QRandomGenerator::global()->generateDouble() * total;
+    for (const Node& node : m_nodes) {
+        if (node.errorRate >= POOL_UNHEALTHY_ERROR_RATE) {
+            continue;
+        }
+        target -= weight(node);
+        if (target <= 0) {
+            return node.url;
+        }
+    }
+    return m_nodes.last().url;
+}
+
+QString ApiEndpointPool::preferred() const
+{
+    QMutexLocker locker(&m_mutex);
+    const Node* node = best();
+    return node ? node->url : QString();
+}
+
+bool ApiEndpointPool::hasHost(const QString& host) const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const Node& node : m_nodes) {
+        if (QUrl(node.url).host().compare(host, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const ApiEndpointPool::Node* ApiEndpointPool::best() const
+{
+    const Node* best = nullptr;
+    for (const Node& node : m_nodes) {
+        if (!best || weight(node) > weight(*best)) {
+            best = &node;
+        }
+    }
+    return best;
+}
+
+void ApiEndpointPool::recordSuccess(const QString& endpoint)
+{
+    recordOutcome(endpoint, true);
+}
+
+void ApiEndpointPool::recordFailure(const QString& endpoint)
+{
+    recordOutcome(endpoint, false);
+}
+
+void ApiEndpointPool::recordOutcome(const QString& endpoint, bool ok)
+{
+    QMutexLocker locker(&m_mutex);
+    for (Node& node : m_nodes) {
+        if (node.url != endpoint) {
+            continue;
+        }
+        bool wasHealthy = node.errorRate < POOL_UNHEALTHY_ERROR_RATE;
+        node.errorRate += POOL_ERROR_ALPHA * ((ok ? 0.0 : 1.0) - node.errorRate);
+        bool healthy = node.errorRate < POOL_UNHEALTHY_ERROR_RATE;
+        if (healthy != wasHealthy) {
+            AbstractLogger::warning() << QStringLiteral("API endpoint %1 is %2")
+                                           .arg(endpoint,
+                                                healthy ? QStringLiteral("healthy again")
+                                                        : QStringLiteral("failing, routing around it"));
+        }
+    }
+}
+
+void ApiEndpointPool::recordProbe(const QString& endpoint, bool ok, qint64 rttMs)
+{
+    if (ok) {
+        QMutexLocker locker(&m_mutex);
+        for (Node& node : m_nodes) {
+            if (node.url == endpoint) {
+                node.rttMs = node.rttMs < 0 ? rttMs : node.rttMs + POOL_RTT_ALPHA * (rttMs - node.rttMs);
+            }
+        }
+    }
+    recordOutcome(endpoint, ok);
+}
+
+/**
+ * @brief Time a HEAD request to every node. Any HTTP answer below 500 counts
+ * as alive, the status itself doesn't matter.
+ */
+void ApiEndpointPool::probe()
+{
+    QStringList urls;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const Node& node : std::as_const(m_nodes)) {
+            urls.append(node.url);
+        }
+    }
+
+    for (const QString& url : urls) {
+        QNetworkRequest request{ QUrl(url) };
+        request.setTransferTimeout(POOL_PROBE_TIMEOUT_MS);
+
+        auto clock = QSharedPointer<QElapsedTimer>::create();
+        clock->start();
+        QNetworkReply* reply = UploadNetwork::instance()->networkAccessManager()->head(request);
+        connect(reply, &QNetworkReply::finished, this, [this, reply, url, clock]() {
+            reply->deleteLater();
+            QVariant status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+            bool ok = status.isValid() && status.toInt() < 500;
+            recordProbe(url, ok, clock->elapsed());
+        });
+    }
+}
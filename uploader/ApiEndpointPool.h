@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef APIENDPOINTPOOL_H
+#define APIENDPOINTPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+class QTimer;
+
+/**
+ * @brief Spreads API requests over every node listed in endpoints.json.
+ *
+ * Each node's round-trip time is probed in the background and smoothed, as
+ * is its error rate from probes and real requests. `pick()` chooses among the
+ * healthy nodes at random, weighted towards low latency and few errors, so
+ * users mostly hit their nearest node while the others still see enough
+ * traffic to notice when they recover. A node whose error rate passes 50% is
+ * left out until it recovers; if every node is unhealthy the least bad one
+ * is used.
+ *
+ * The node list comes from `serverAPIEndpointList`, or `serverAPIEndpoint`
+ * when that is empty, and is re-read when the config file changes. Lives on
+ * the `UploadNetwork` thread; `pick()`, `preferred()`, `hasHost()` and the `record*`
+ * functions may be called from any thread.
+ */
+class ApiEndpointPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ApiEndpointPool* instance();
+
+    QString pick() const;
+    // The node with the best expected latency, for pre-connecting
+    QString preferred() const;
+    // Whether `host` serves one of the listed nodes
+    bool hasHost(const QString& host) const;
+
+    void recordSuccess(const QString& endpoint);
+    void recordFailure(const QString& endpoint);
+
+private:
+    explicit ApiEndpointPool();
+
+    struct Node
+    {
+        QString url;
+        double rttMs = -1; // smoothed, -1 until probed
+        double errorRate = 0; // smoothed, 0..1
+    };
+
+    void reloadConfig();
+    void probe();
+    void recordProbe(const QString& endpoint, bool ok, qint64 rttMs);
+    void recordOutcome(const QString& endpoint, bool ok);
+    // Both expect m_mutex to be held
+    const Node* best() const;
+    static double weight(const Node& node);
+
+    mutable QMutex m_mutex;
+    QList<Node> m_nodes;
+    QTimer* m_probeTimer;
+};
+
+#endif // APIENDPOINTPOOL_H
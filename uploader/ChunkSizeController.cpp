@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "ChunkSizeController.h"
+
+#include <QString>
+
+#include "../utils/abstractlogger.h"
+
+static constexpr qint64 CHUNK_ALIGNMENT = 64 * 1024;
+static constexpr qint64 CHUNK_MIN_DURATION_MS = 1000;
+static constexpr qint64 CHUNK_MAX_DURATION_MS = 4000;
+static constexpr int CHUNK_ROUND_TRIPS = 10;
+// Weight of a new sample in the moving averages
+static constexpr double CHUNK_SMOOTHING = 0.3;
+// Transfers this short are dominated by timer resolution
+static constexpr qint64 CHUNK_MIN_SAMPLE_MS = 20;
+
+static double smooth(double average, double sample)
+{
+    return average == 0 ? sample : average + CHUNK_SMOOTHING * (sample - average);
+}
+
+ChunkSizeController::ChunkSizeController(qint64 initial, qint64 minimum, qint64 maximum)
+  : m_minimum(qMax<qint64>(1, minimum))
+  , m_maximum(qMax(m_minimum, maximum))
+{
+    m_chunkSize = qBound(m_minimum, initial, m_maximum);
+}
+
+qint64 ChunkSizeController::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+bool ChunkSizeController::isAdaptive() const
+{
+    return m_minimum < m_maximum;
+}
+
+double ChunkSizeController::goodput() const
+{
+    return m_goodput;
+}
+
+double ChunkSizeController::roundTripMs() const
+{
+    return m_roundTripMs;
+}
+
+void ChunkSizeController::recordRoundTrip(qint64 elapsedMs)
+{
+    m_roundTripMs = smooth(m_roundTripMs, double(qMax<qint64>(1, elapsedMs)));
+}
+
+void ChunkSizeController::recordChunk(qint64 bytes, qint64 sendMs, qint64 ackMs)
+{
+    if (!isAdaptive() || bytes <= 0) {
+        return;
+    }
+    recordRoundTrip(ackMs);
+
+    qint64 elapsed = sendMs + ackMs;
+    if (elapsed < CHUNK_MIN_SAMPLE_MS) {
+        // Too fast to measure, the link is faster than this chunk size shows
+        resize(m_chunkSize * 2, "too fast to measure");
+        return;
+    }
+    m_goodput = smooth(m_goodput, bytes * 1000.0 / elapsed);
+
+    qint64 duration = qBound<qint64>(CHUNK_MIN_DURATION_MS,
+                                     qint64(m_roundTripMs * CHUNK_ROUND_TRIPS),
+                                     CHUNK_MAX_DURATION_MS);
+    qint64 target = qint64(m_goodput * duration / 1000);
+    resize(qBound(m_chunkSize / 2, target, m_chunkSize * 2), "measured");
+}
+
+void ChunkSizeController::recordFailure()
+{
+    if (isAdaptive()) {
+        resize(m_chunkSize / 2, "chunk failed");
+    }
+}
+
+void ChunkSizeController::resize(qint64 target, const char* reason)
+{
+    if (target >= CHUNK_ALIGNMENT) {
+        target -= target % CHUNK_ALIGNMENT;
+    }
+    target = qBound(m_minimum, target, m_maximum);
+    // Small corrections aren't worth the churn in the log
+    if (target == m_chunkSize || (qAbs(target - m_chunkSize) < m_chunkSize / 8 && target != m_minimum &&
+                                  target != m_maximum)) {
+        return;
+    }
+
+    AbstractLogger::info() << QStringLiteral("Chunk size %1 KiB -> %2 KiB (%3: %4 MB/s per connection, RTT %5 ms)")
+                                .arg(m_chunkSize / 1024)
+                                .arg(target / 1024)
+                                .arg(QLatin1String(reason))
+                                .arg(m_goodput / 1'000'000, 0, 'f', 2)
+                                .arg(m_roundTripMs, 0, 'f', 0);
+    m_chunkSize = target;
+}
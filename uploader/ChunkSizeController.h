@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef CHUNKSIZECONTROLLER_H
+#define CHUNKSIZECONTROLLER_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Sizes the chunks of a session upload from the round-trip time and
+ * goodput measured on the chunks before.
+ *
+ * Each chunk leaves its connection idle for about one round trip while the
+ * acknowledgement comes back, and a chunk cut off by a dropped link is sent
+ * again from the committed offset. Chunks are sized to take about ten round
+ * trips, which keeps that idle time near 10%, but between one and four
+ * seconds of transfer, so that a failure costs a few seconds of resending.
+ *
+ * Goodput is measured per connection (one chunk each), the round-trip time
+ * from the delay between the last byte sent and the response. Both are
+ * smoothed; the size moves at most by a factor of two per chunk, halves on a
+ * failed chunk and stays within the bounds. Equal bounds fix the size.
+ */
+class ChunkSizeController
+{
+public:
+    ChunkSizeController(qint64 initial, qint64 minimum, qint64 maximum);
+
+    qint64 chunkSize() const;
+    bool isAdaptive() const;
+
+    // A control request (session, offset) that measures the round trip alone
+    void recordRoundTrip(qint64 elapsedMs);
+    // sendMs: request start to last byte handed over, ackMs: from there to the response
+    void recordChunk(qint64 bytes, qint64 sendMs, qint64 ackMs);
+    void recordFailure();
+
+    double goodput() const;
+    double roundTripMs() const;
+
+private:
+    void resize(qint64 target, const char* reason);
+
+    qint64 m_chunkSize;
+    qint64 m_minimum;
+    qint64 m_maximum;
+    // Bytes per second on one connection
+    double m_goodput = 0;
+    double m_roundTripMs = 0;
+};
+
+#endif // CHUNKSIZECONTROLLER_H
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "CircuitBreaker.h"
+
+#include <QHash>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QUrl>
+
+#include "../utils/abstractlogger.h"
+
+// Consecutive retryable failures that open the breaker
+static constexpr int BREAKER_FAILURE_THRESHOLD = 5;
+static constexpr qint64 BREAKER_OPEN_MS = 30 * 1000;
+static constexpr qint64 BREAKER_MAX_OPEN_MS = 5 * 60 * 1000;
+// How long waiters poll while the probe is out
+static constexpr qint64 BREAKER_PROBE_POLL_MS = 2000;
+
+CircuitBreaker::CircuitBreaker(const QString& endpoint)
+  : m_endpoint(endpoint)
+  , m_openMs(BREAKER_OPEN_MS)
+{}
+
+CircuitBreaker* CircuitBreaker::forEndpoint(const QUrl& url)
+{
+    static QMutex registryMutex;
+    static QHash<QString, CircuitBreaker*> registry;
+
+    QString key = url.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment |
+                               QUrl::RemoveUserInfo)
+                    .toString();
+
+    QMutexLocker locker(&registryMutex);
+    CircuitBreaker*& breaker = registry[key];
+    if (!breaker) {
+        breaker = new CircuitBreaker(key);
+    }
+    return breaker;
+}
+
+qint64 CircuitBreaker::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+
+    switch (m_state) {
+        case State::Closed:
+            return 0;
+        case State::Open: {
+            qint64 remaining = m_openMs - m_openedAt.elapsed();
+            if (remaining > 0) {
+                // Spread the waiters out so they don't all ask at once
+                return remaining + QRandomGenerator::global()->bounded(BREAKER_PROBE_POLL_MS);
+            }
+            m_state = State::HalfOpen;
+            m_probeStarted.start();
+            AbstractLogger::info() << QStringLiteral("Probing %1").arg(m_endpoint);
+            return 0;
+        }
+        case State::HalfOpen:
+            // A probe that never reported back (cancelled) doesn't block forever
+            if (m_probeStarted.elapsed() > m_openMs) {
+                m_probeStarted.start();
+                return 0;
+            }
+            return BREAKER_PROBE_POLL_MS;
+    }
+    return 0;
+}
+
+void CircuitBreaker::recordSuccess()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_state != State::Closed) {
+        AbstractLogger::info() << QStringLiteral("%1 is reachable again").arg(m_endpoint);
+    }
+    m_state = State::Closed;
+    m_failures = 0;
+    m_openMs = BREAKER_OPEN_MS;
+}
+
+void CircuitBreaker::recordFailure()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_state == State::HalfOpen) {
+        open(qMin(m_openMs * 2, BREAKER_MAX_OPEN_MS));
+    } else if (m_state == State::Closed && ++m_failures >= BREAKER_FAILURE_THRESHOLD) {
+        open(BREAKER_OPEN_MS);
+    }
+}
+
+void CircuitBreaker::open(qint64 durationMs)
+{
+    m_state = State::Open;
+    m_openMs = durationMs;
+    m_openedAt.start();
+    AbstractLogger::warning() << QStringLiteral("%1 keeps failing, pausing requests for %2 s")
+                                   .arg(m_endpoint)
+                                   .arg(durationMs / 1000);
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef CIRCUITBREAKER_H
+#define CIRCUITBREAKER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+
+class QUrl;
+
+/**
+ * @brief Per-endpoint circuit breaker that stops retries from piling onto an
+ * API that is down.
+ *
+ * After several consecutive retryable failures the breaker opens and every
+ * request to that endpoint waits. Once the open period has passed a single
+ * probe is let through: if it succeeds the breaker closes, otherwise it opens
+ * again for twice as long.
+ *
+ * Safe to use from any thread.
+ */
+class CircuitBreaker
+{
+public:
+    // Keyed by scheme, host and port
+    static CircuitBreaker* forEndpoint(const QUrl& url);
+
+    /**
+     * @brief Ask to send a request.
+     * @return 0 if it may go out now, otherwise milliseconds to wait before
+     * asking again.
+     */
+    qint64 acquire();
+    void recordSuccess();
+    void recordFailure();
+
+private:
+    explicit CircuitBreaker(const QString& endpoint);
+
+    enum class State
+    {
+        Closed,
+        Open,
+        HalfOpen,
+    };
+
+    void open(qint64 durationMs);
+
+    QMutex m_mutex;
+    QString m_endpoint;
+    State m_state = State::Closed;
+    int m_failures = 0;
+    qint64 m_openMs;
+    QElapsedTimer m_openedAt;
+    QElapsedTimer m_probeStarted;
+};
+
+#endif // CIRCUITBREAKER_H
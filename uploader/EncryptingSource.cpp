@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "EncryptingSource.h"
+
+#include <QtEndian>
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+static constexpr qint64 ENCRYPTION_SEGMENT_SIZE = 64 * 1024;
+static constexpr int ENCRYPTION_KEY_SIZE = 32;
+static constexpr int ENCRYPTION_NONCE_SIZE = 12;
+static constexpr int ENCRYPTION_NONCE_PREFIX_SIZE = 7;
+static constexpr int ENCRYPTION_TAG_SIZE = 16;
+static constexpr int ENCRYPTION_HEADER_SIZE = 16;
+
+EncryptingSource::EncryptingSource(QSharedPointer<UploadSource> inner)
+  : m_inner(std::move(inner))
+  , m_key(ENCRYPTION_KEY_SIZE, Qt::Uninitialized)
+  , m_header(ENCRYPTION_HEADER_SIZE, '\0')
+  , m_ctx(EVP_CIPHER_CTX_new())
+{
+    char* header = m_header.data();
+    std::memcpy(header, "FSE1", 4);
+    qToBigEndian<quint32>(quint32(ENCRYPTION_SEGMENT_SIZE), header + 4);
+
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(m_key.data()), ENCRYPTION_KEY_SIZE) != 1 ||
+        RAND_bytes(reinterpret_cast<unsigned char*>(header + 8), ENCRYPTION_NONCE_PREFIX_SIZE) != 1) {
+        m_error = QStringLiteral("No randomness for the encryption key");
+        return;
+    }
+    // The key schedule is set up once, segments only change the nonce
+    if (!m_ctx ||
+        EVP_EncryptInit_ex(m_ctx, EVP_aes_256_gcm(), nullptr,
+                           reinterpret_cast<const unsigned char*>(m_key.constData()), nullptr) != 1) {
+        m_error = QStringLiteral("AES-256-GCM is not available");
+    }
+}
+
+EncryptingSource::~EncryptingSource()
+{
+    EVP_CIPHER_CTX_free(m_ctx);
+}
+
+qint64 EncryptingSource::segmentCount() const
+{
+    // An empty payload still gets one (empty, final) segment
+    return qMax<qint64>(1, (m_inner->size() + ENCRYPTION_SEGMENT_SIZE - 1) / ENCRYPTION_SEGMENT_SIZE);
+}
+
+qint64 EncryptingSource::size() const
+{
+    return ENCRYPTION_HEADER_SIZE + m_inner->size() + segmentCount() * ENCRYPTION_TAG_SIZE;
+}
+
+QByteArray EncryptingSource::key() const
+{
+    return m_key;
+}
+
+QString EncryptingSource::errorString() const
+{
+    return m_error.isEmpty() ? m_inner->errorString() : m_error;
+}
+
+void EncryptingSource::setReleaseBehind(bool releaseBehind)
+{
+    m_inner->setReleaseBehind(releaseBehind);
+}
+
+bool EncryptingSource::encryptSegment(qint64 index)
+{
+    qint64 plainOffset = index * ENCRYPTION_SEGMENT_SIZE;
+    qint64 plainLength = qMin(ENCRYPTION_SEGMENT_SIZE, m_inner->size() - plainOffset);
+
+    m_plain.resize(plainLength);
+    for (qint64 read = 0; read < plainLength;) {
+        qint64 chunk = m_inner->readAt(plainOffset + read, m_plain.data() + read, plainLength - read);
+        if (chunk <= 0) {
+            return false;
+        }
+        read += chunk;
+    }
+
+    unsigned char nonce[ENCRYPTION_NONCE_SIZE];
+    std::memcpy(nonce, m_header.constData() + 8, ENCRYPTION_NONCE_PREFIX_SIZE);
+    qToBigEndian<quint32>(quint32(index), nonce + ENCRYPTION_NONCE_PREFIX_SIZE);
+    nonce[ENCRYPTION_NONCE_SIZE - 1] = index == segmentCount() - 1 ? 1 : 0;
+
+    m_segment.resize(plainLength + ENCRYPTION_TAG_SIZE);
+    auto* out = reinterpret_cast<unsigned char*>(m_segment.data());
+    int written = 0;
+    int finalWritten = 0;
+    if (EVP_EncryptInit_ex(m_ctx, nullptr, nullptr, nullptr, nonce) != 1 ||
+        EVP_EncryptUpdate(m_ctx, out, &written,
+                          reinterpret_cast<const unsigned char*>(m_plain.constData()), int(plainLength)) != 1 ||
+        EVP_EncryptFinal_ex(m_ctx, out + written, &finalWritten) != 1 ||
+        EVP_CIPHER_CTX_ctrl(m_ctx, EVP_CTRL_GCM_GET_TAG, ENCRYPTION_TAG_SIZE, out + plainLength) != 1) {
+        m_error = QStringLiteral("Encrypting the upload failed");
+        return false;
+    }
+
+    m_segmentIndex = index;
+    return true;
+}
+
+qint64 EncryptingSource::readAt(qint64 offset, char* data, qint64 maxSize)
+{
+    if (!m_error.isEmpty() || offset < 0 || offset > size()) {
+        return -1;
+    }
+
+    qint64 total = 0;
+    if (offset < ENCRYPTION_HEADER_SIZE) {
+        total = qMin(maxSize, ENCRYPTION_HEADER_SIZE - offset);
+        std::memcpy(data, m_header.constData() + offset, total);
+    }
+
+    constexpr qint64 stride = ENCRYPTION_SEGMENT_SIZE + ENCRYPTION_TAG_SIZE;
+    while (total < maxSize && offset + total < size()) {
+        qint64 position = offset + total - ENCRYPTION_HEADER_SIZE;
+        qint64 index = position / stride;
+        if (index != m_segmentIndex && !encryptSegment(index)) {
+            return total > 0 ? total : -1;
+        }
+        qint64 within = position - index * stride;
+        qint64 length = qMin<qint64>(maxSize - total, m_segment.size() - within);
+        std::memcpy(data + total, m_segment.constData() + within, length);
+        total += length;
+    }
+    return total;
+}
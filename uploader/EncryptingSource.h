@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef ENCRYPTINGSOURCE_H
+#define ENCRYPTINGSOURCE_H
+
+#include <QByteArray>
+#include <QSharedPointer>
+
+#include "UploadSource.h"
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+/**
+ * @brief Encrypts another source with AES-256-GCM as it is read.
+ *
+ * The payload is cut into fixed-size segments that are encrypted and
+ * authenticated on their own, so only one segment is held in memory and any
+ * offset can be served again for rewinds and retries. Layout:
+ *
+ *     header:  "FSE1", segment size (u32 BE), nonce prefix[7], reserved[1]
+ *     segment: ciphertext, tag[16]   (repeated, the last may be short)
+ *
+ * The nonce of segment i is the prefix, i as u32 BE, and a byte that is 1
+ * for the last segment only, so segments can't be reordered or the payload
+ * truncated unnoticed.
+ *
+ * OpenSSL picks the AES-NI / ARMv8 crypto code path where the CPU has it.
+ */
+class EncryptingSource : public UploadSource
+{
+public:
+    explicit EncryptingSource(QSharedPointer<UploadSource> inner);
+    ~EncryptingSource() override;
+
+    qint64 size() const override;
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override;
+    QString errorString() const override;
+    void setReleaseBehind(bool releaseBehind) override;
+
+    /// The random 256-bit key, to be shared with the URL only
+    QByteArray key() const;
+
+private:
+    bool encryptSegment(qint64 index);
+    qint64 segmentCount() const;
+
+    QSharedPointer<UploadSource> m_inner;
+    QByteArray m_key;
+    QByteArray m_header;
+    EVP_CIPHER_CTX* m_ctx = nullptr;
+    QByteArray m_plain;
+    QByteArray m_segment;
+    qint64 m_segmentIndex = -1;
+    QString m_error;
+};
+
+#endif // ENCRYPTINGSOURCE_H
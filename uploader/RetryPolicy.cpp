@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "RetryPolicy.h"
+
+#include <QDateTime>
+#include <QLocale>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QTimeZone>
+
+// Never wait longer than this, whatever Retry-After says
+static constexpr qint64 RETRY_AFTER_MAX_MS = 5 * 60 * 1000;
+
+RetryPolicy::RetryPolicy(int maxRetries, int baseDelayMs, int maxDelayMs)
+  : m_maxRetries(maxRetries)
+  , m_baseDelayMs(qMax(1, baseDelayMs))
+  , m_maxDelayMs(qMax(baseDelayMs, maxDelayMs))
+{}
+
+RetryPolicy::ErrorClass RetryPolicy::classify(QNetworkReply* reply)
+{
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 429) {
+        return ErrorClass::RateLimited;
+    }
+    if (status == 408 || status >= 500) {
+        return ErrorClass::ServerError;
+    }
+    if (status != 0) {
+        return ErrorClass::Permanent;
+    }
+    // No HTTP status: the connection itself failed. Our own aborts disconnect
+    // first, so a cancelled reply here is a transfer timeout firing.
+    switch (reply->error()) {
+        case QNetworkReply::SslHandshakeFailedError:
+        case QNetworkReply::ProtocolUnknownError:
+        case QNetworkReply::ProtocolInvalidOperationError:
+            return ErrorClass::Permanent;
+        default:
+            return ErrorClass::Transient;
+    }
+}
+
+bool RetryPolicy::isRetryable(ErrorClass errorClass)
+{
+    return errorClass != ErrorClass::Permanent;
+}
+
+qint64 RetryPolicy::retryAfter(QNetworkReply* reply)
+{
+    QByteArray value = reply->rawHeader("Retry-After").trimmed();
+    if (value.isEmpty()) {
+        return -1;
+    }
+
+    bool ok = false;
+    qint64 seconds = value.toLongLong(&ok);
+    if (ok) {
+        return qBound<qint64>(0, seconds * 1000, RETRY_AFTER_MAX_MS);
+    }
+
+    // HTTP-date, e.g. "Wed, 21 Oct 2015 07:28:00 GMT"
+    if (!value.endsWith(" GMT")) {
+        return -1;
+    }
+    QDateTime local = QLocale::c().toDateTime(QString::fromLatin1(value).chopped(4),
+                                              QStringLiteral("ddd, dd MMM yyyy HH:mm:ss"));
+    if (!local.isValid()) {
+        return -1;
+    }
+    QDateTime date(local.date(), local.time(), QTimeZone::utc());
+    qint64 delay = QDateTime::currentDateTimeUtc().msecsTo(date);
+    return qBound<qint64>(0, delay, RETRY_AFTER_MAX_MS);
+}
+
+qint64 RetryPolicy::nextDelay(QNetworkReply* reply)
+{
+    ErrorClass errorClass = classify(reply);
+    if (!isRetryable(errorClass) || m_retries >= m_maxRetries) {
+        return -1;
+    }
+
+    // Equal jitter: half the backoff is fixed, half random, so parallel
+    // uploads that failed together don't come back together
+    qint64 backoff = qMin<qint64>(m_maxDelayMs, qint64(m_baseDelayMs) << qMin(m_retries, 20));
+    qint64 delay = backoff / 2 + QRandomGenerator::global()->bounded(backoff / 2 + 1);
+    ++m_retries;
+
+    if (errorClass == ErrorClass::RateLimited || errorClass == ErrorClass::ServerError) {
+        delay = qMax(delay, retryAfter(reply));
+    }
+    return delay;
+}
+
+int RetryPolicy::retries() const
+{
+    return m_retries;
+}
+
+void RetryPolicy::reset()
+{
+    m_retries = 0;
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef RETRYPOLICY_H
+#define RETRYPOLICY_H
+
+#include <QtGlobal>
+
+class QNetworkReply;
+
+/**
+ * @brief Decides whether and when a failed request is retried.
+ *
+ * Connection failures, timeouts, 408 and 5xx are retried with exponential
+ * backoff and jitter, 429 and 503 additionally honour `Retry-After`. Any other
+ * 4xx, and TLS or protocol failures, are permanent.
+ */
+class RetryPolicy
+{
+public:
+    enum class ErrorClass
+    {
+        Transient,   // the connection failed, no HTTP status
+        ServerError, // 408 and 5xx
+        RateLimited, // 429
+        Permanent,
+    };
+
+    explicit RetryPolicy(int maxRetries = 5, int baseDelayMs = 1000, int maxDelayMs = 30000);
+
+    static ErrorClass classify(QNetworkReply* reply);
+    static bool isRetryable(ErrorClass errorClass);
+    // Milliseconds the server asked us to wait, or -1
+    static qint64 retryAfter(QNetworkReply* reply);
+
+    /**
+     * @brief Account for a failed attempt.
+     * @return Milliseconds to wait before retrying, or -1 to give up.
+     */
+    qint64 nextDelay(QNetworkReply* reply);
+    int retries() const;
+    void reset();
+
+private:
+    int m_maxRetries;
+    int m_baseDelayMs;
+    int m_maxDelayMs;
+    int m_retries = 0;
+};
+
+#endif // RETRYPOLICY_H
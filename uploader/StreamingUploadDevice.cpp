@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "StreamingUploadDevice.h"
+
+#include "UploadRateLimiter.h"
+
+#include <algorithm>
+#include <cstring>
+
+qint64 StreamingUploadDevice::Segment::length() const
+{
+    return source ? sourceLength : bytes.size();
+}
+
+StreamingUploadDevice::StreamingUploadDevice(QObject* parent)
+  : QIODevice(parent)
+{
+    connect(UploadRateLimiter::instance(), &UploadRateLimiter::tokensAvailable, this, [this]() {
+        if (m_throttled) {
+            m_throttled = false;
+            emit readyRead();
+        }
+    });
+}
+
+void StreamingUploadDevice::setPriority(UploadPriority priority)
+{
+    m_priority = priority;
+}
+
+void StreamingUploadDevice::appendBytes(const QByteArray& bytes)
+{
+    if (bytes.isEmpty()) {
+        return;
+    }
+    m_segments.append({ m_size, bytes, {}, 0, 0 });
+    m_size += bytes.size();
+}
+
+/**
+ * @brief Append `length` bytes of a payload source starting at `offset`
+ * (-1 appends the rest of it). The source must already be open, its size is
+ * fixed from here on.
+ */
+void StreamingUploadDevice::appendSource(const QSharedPointer<UploadSource>& source,
+                                         qint64 offset,
+                                         qint64 length)
+{
+    if (source.isNull() || offset < 0 || offset >= source->size()) {
+        return;
+    }
+    qint64 available = source->size() - offset;
+    length = length < 0 ? available : qMin(length, available);
+    if (length == 0) {
+        return;
+    }
+    m_segments.append({ m_size, {}, source, offset, length });
+    m_size += length;
+}
+
+void StreamingUploadDevice::appendFormDataPart(const QByteArray& boundary,
+                                               const QString& name,
+                                               const QString& fileName,
+                                               const QString& contentType,
+                                               const QSharedPointer<UploadSource>& source)
+{
+    appendBytes(formDataHeader(boundary, name, fileName, contentType));
+    appendSource(source);
+    appendBytes(QByteArrayLiteral("\r\n"));
+}
+
+void StreamingUploadDevice::appendClosingBoundary(const QByteArray& boundary)
+{
+    appendBytes(closingBoundary(boundary));
+}
+
+QByteArray StreamingUploadDevice::formDataHeader(const QByteArray& boundary,
+                                                 const QString& name,
+                                                 const QString& fileName,
+                                                 const QString& contentType)
+{
+    QByteArray header;
+    header.append("--" + boundary + "\r\n");
+    header.append("Content-Disposition: form-data; name=\"" + name.toUtf8() + "\"; filename=\"" +
+                  fileName.toUtf8() + "\"\r\n");
+    header.append("Content-Type: " + contentType.toUtf8() + "\r\n");
+    header.append("\r\n");
+    return header;
+}
+
+QByteArray StreamingUploadDevice::closingBoundary(const QByteArray& boundary)
+{
+    return "--" + boundary + "--\r\n";
+}
+
+bool StreamingUploadDevice::open(OpenMode mode)
+{
+    if (mode & WriteOnly) {
+        setErrorString(QStringLiteral("StreamingUploadDevice is read-only"));
+        return false;
+    }
+    m_readPos = 0;
+    // Skip QIODevice's internal buffer, readData already writes into the
+    // caller's buffer
+    return QIODevice::open(mode | Unbuffered);
+}
+
+bool StreamingUploadDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 StreamingUploadDevice::size() const
+{
+    return m_size;
+}
+
+bool StreamingUploadDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > m_size || !QIODevice::seek(pos)) {
+        return false;
+    }
+    m_readPos = pos;
+    return true;
+}
+
+bool StreamingUploadDevice::atEnd() const
+{
+    return m_readPos >= m_size;
+}
+
+bool StreamingUploadDevice::reset()
+{
+    return seek(0);
+}
+
+int StreamingUploadDevice::segmentAt(qint64 pos) const
+{
+    auto it = std::upper_bound(m_segments.cbegin(), m_segments.cend(), pos,
+                               [](qint64 value, const Segment& segment) {
+                                   return value < segment.start;
+                               });
+    return static_cast<int>(it - m_segments.cbegin()) - 1;
+}
+
+qint64 StreamingUploadDevice::readData(char* data, qint64 maxSize)
+{
+    if (maxSize <= 0 || m_readPos >= m_size) {
+        return 0;
+    }
+
+    UploadRateLimiter* limiter = UploadRateLimiter::instance();
+    qint64 allowed = limiter->acquire(m_priority, qMin(maxSize, m_size - m_readPos));
+    if (allowed == 0) {
+        // Nothing to send yet, readyRead() follows once there are tokens
+        m_throttled = true;
+        return 0;
+    }
+
+    qint64 read = readSegments(data, allowed);
+    limiter->refund(m_priority, allowed - qMax<qint64>(read, 0));
+    return read;
+}
+
+qint64 StreamingUploadDevice::readSegments(char* data, qint64 maxSize)
+{
+    qint64 total = 0;
+    int index = segmentAt(m_readPos);
+
+    while (total < maxSize && index >= 0 && index < m_segments.size()) {
+        const Segment& segment = m_segments.at(index);
+        qint64 within = m_readPos - segment.start;
+        qint64 wanted = qMin(maxSize - total, segment.length() - within);
+
+        qint64 read;
+        if (segment.source) {
+            read = segment.source->readAt(segment.sourceOffset + within, data + total, wanted);
+            if (read < 0) {
+                setErrorString(segment.source->errorString());
+                return total > 0 ? total : -1;
+            }
+        } else {
+            std::memcpy(data + total, segment.bytes.constData() + within, wanted);
+            read = wanted;
+        }
+
+        total += read;
+        m_readPos += read;
+        if (read < wanted) {
+            break;
+        }
+        ++index;
+    }
+
+    return total;
+}
+
+qint64 StreamingUploadDevice::writeData(const char* data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
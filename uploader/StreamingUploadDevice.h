@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef STREAMINGUPLOADDEVICE_H
+#define STREAMINGUPLOADDEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QSharedPointer>
+
+#include "UploadPriority.h"
+#include "UploadSource.h"
+
+/**
+ * @brief Request body that serves a list of byte segments and payload
+ * sources as one stream.
+ *
+ * Used for multipart bodies: the part headers and the closing boundary are
+ * small QByteArrays, the payload is read straight from its `UploadSource`
+ * into the network buffer, so the payload is never copied into a
+ * concatenated body. The size is known up front and the device is seekable,
+ * which lets QNetworkAccessManager rewind it for redirects and retries.
+ *
+ * Reads are paced by `UploadRateLimiter` according to the body's priority.
+ */
+class StreamingUploadDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit StreamingUploadDevice(QObject* parent = nullptr);
+
+    void appendBytes(const QByteArray& bytes);
+    void appendSource(const QSharedPointer<UploadSource>& source,
+                      qint64 offset = 0,
+                      qint64 length = -1);
+
+    // multipart/form-data helpers
+    void appendFormDataPart(const QByteArray& boundary,
+                            const QString& name,
+                            const QString& fileName,
+                            const QString& contentType,
+                            const QSharedPointer<UploadSource>& source);
+    void appendClosingBoundary(const QByteArray& boundary);
+    // The bytes around a part's payload, for building the body elsewhere
+    static QByteArray formDataHeader(const QByteArray& boundary,
+                                     const QString& name,
+                                     const QString& fileName,
+                                     const QString& contentType);
+    static QByteArray closingBoundary(const QByteArray& boundary);
+
+    void setPriority(UploadPriority priority);
+
+    bool open(OpenMode mode) override;
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+    bool atEnd() const override;
+    bool reset() override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    struct Segment
+    {
+        qint64 start;
+        QByteArray bytes;
+        QSharedPointer<UploadSource> source;
+        qint64 sourceOffset;
+        qint64 sourceLength;
+
+        qint64 length() const;
+    };
+
+    int segmentAt(qint64 pos) const;
+    qint64 readSegments(char* data, qint64 maxSize);
+
+    QList<Segment> m_segments;
+    qint64 m_size = 0;
+    qint64 m_readPos = 0;
+    UploadPriority m_priority = UploadPriority::Bulk;
+    // Waiting for the rate limiter to hand out tokens
+    bool m_throttled = false;
+};
+
+#endif // STREAMINGUPLOADDEVICE_H
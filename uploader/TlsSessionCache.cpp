@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "TlsSessionCache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include "../utils/abstractlogger.h"
+
+// Used when the server gives no lifetime hint
+static constexpr qint64 TLS_SESSION_DEFAULT_LIFETIME = 2 * 3600;
+// TLS 1.3 tickets are never valid for longer than this
+static constexpr qint64 TLS_SESSION_MAX_LIFETIME = 7 * 24 * 3600;
+// Tickets a process takes from the file per host, and keeps per host at most
+static constexpr int TLS_SESSION_CLAIM = 2;
+static constexpr int TLS_SESSION_POOL_SIZE = 8;
+static constexpr int TLS_SESSION_SEEN = 64;
+static constexpr int TLS_SESSION_LOCK_TIMEOUT_MS = 2000;
+
+static QString hostKey(const QUrl& url)
+{
+    return QStringLiteral("%1:%2").arg(url.host()).arg(url.port(443));
+}
+
+TlsSessionCache::TlsSessionCache()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QDir().mkpath(dir);
+    m_path = dir + QStringLiteral("/tls-sessions.json");
+    m_lockPath = m_path + QStringLiteral(".lock");
+    claim();
+
+    // Runs wherever quit happens, the mutex makes that safe
+    if (QCoreApplication* app = QCoreApplication::instance()) {
+        QObject::connect(app, &QCoreApplication::aboutToQuit, app, [this]() { flush(); }, Qt::DirectConnection);
+    }
+}
+
+TlsSessionCache* TlsSessionCache::instance()
+{
+    static TlsSessionCache cache;
+    return &cache;
+}
+
+QSslConfiguration TlsSessionCache::configurationFor(const QUrl& url, const QSslConfiguration& base)
+{
+    QSslConfiguration config = base;
+    // Without it Qt doesn't hand out the tickets it receives
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    QMutexLocker locker(&m_mutex);
+    QList<Ticket>& pool = m_pools[hostKey(url)];
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    while (!pool.isEmpty()) {
+        Ticket ticket = pool.takeLast();
+        if (ticket.expiresAt > now) {
+            m_reserved.insert(ticket.ticket, ticket);
+            config.setSessionTicket(ticket.ticket);
+            break;
+        }
+    }
+    return config;
+}
+
+void TlsSessionCache::release(const QUrl& url, const QSslConfiguration& config, bool handshake)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_reserved.find(config.sessionTicket());
+    if (it == m_reserved.end()) {
+        return;
+    }
+    if (!handshake) {
+        m_pools[hostKey(url)].append(*it);
+    }
+    m_reserved.erase(it);
+}
+
+void TlsSessionCache::store(const QUrl& url, const QSslConfiguration& config)
+{
+    QByteArray ticket = config.sessionTicket();
+    if (ticket.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // Also the ticket a connection was opened with, if it received no new one
+    if (seen(ticket)) {
+        return;
+    }
+
+    int hint = config.sessionTicketLifeTimeHint();
+    qint64 lifetime = hint > 0 ? qMin<qint64>(hint, TLS_SESSION_MAX_LIFETIME)
+                               : TLS_SESSION_DEFAULT_LIFETIME;
+    QList<Ticket>& pool = m_pools[hostKey(url)];
+    pool.append({ ticket, QDateTime::currentSecsSinceEpoch() + lifetime });
+    if (pool.size() > TLS_SESSION_POOL_SIZE) {
+        pool.removeFirst();
+    }
+    m_dirty = true;
+}
+
+/**
+ * @brief Whether the ticket went through this process before, and remember
+ * it if not.
+ */
+bool TlsSessionCache::seen(const QByteArray& ticket)
+{
+    if (m_seen.contains(ticket)) {
+        return true;
+    }
+    m_seen.append(ticket);
+    if (m_seen.size() > TLS_SESSION_SEEN) {
+        m_seen.removeFirst();
+    }
+    return false;
+}
+
+void TlsSessionCache::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty && m_pools.isEmpty()) {
+        return;
+    }
+
+    QLockFile lock(m_lockPath);
+    if (!lock.tryLock(TLS_SESSION_LOCK_TIMEOUT_MS)) {
+        // Leave the file alone rather than overwrite someone else's claim
+        return;
+    }
+
+    QHash<QString, QList<Ticket>> pools = readFile();
+    for (auto it = m_pools.constBegin(); it != m_pools.constEnd(); ++it) {
+        QList<Ticket>& pool = pools[it.key()];
+        pool.append(it.value());
+        if (pool.size() > TLS_SESSION_POOL_SIZE) {
+            pool.remove(0, pool.size() - TLS_SESSION_POOL_SIZE);
+        }
+    }
+    writeFile(pools);
+    m_pools.clear();
+    m_dirty = false;
+}
+
+/**
+ * @brief Take a few tickets per host from the file for this process, and
+ * leave the rest for others.
+ */
+void TlsSessionCache::claim()
+{
+    QLockFile lock(m_lockPath);
+    if (!lock.tryLock(TLS_SESSION_LOCK_TIMEOUT_MS)) {
+        return;
+    }
+
+    QHash<QString, QList<Ticket>> pools = readFile();
+    if (pools.isEmpty()) {
+        return;
+    }
+    for (auto it = pools.begin(); it != pools.end(); ++it) {
+        QList<Ticket>& claimed = m_pools[it.key()];
+        while (!it->isEmpty() && claimed.size() < TLS_SESSION_CLAIM) {
+            claimed.prepend(it->takeLast());
+        }
+        for (const Ticket& ticket : std::as_const(claimed)) {
+            seen(ticket.ticket);
+        }
+    }
+    writeFile(pools);
+}
+
+// Unexpired tickets per host, newest last
+QHash<QString, QList<TlsSessionCache::Ticket>> TlsSessionCache::readFile() const
+{
+    QHash<QString, QList<Ticket>> pools;
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return pools;
+    }
+
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    QJsonObject hosts = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = hosts.constBegin(); it != hosts.constEnd(); ++it) {
+        // A single object is the format from before the pool
+        QJsonArray tickets = it.value().isArray() ? it.value().toArray() : QJsonArray{ it.value() };
+        for (const QJsonValue& value : std::as_const(tickets)) {
+            QJsonObject json = value.toObject();
+            Ticket ticket;
+            ticket.ticket = QByteArray::fromBase64(json[QStringLiteral("ticket")].toString().toLatin1());
+            ticket.expiresAt = json[QStringLiteral("expiresAt")].toInteger();
+            if (!ticket.ticket.isEmpty() && ticket.expiresAt > now) {
+                pools[it.key()].append(ticket);
+            }
+        }
+    }
+    return pools;
+}
+
+void TlsSessionCache::writeFile(const QHash<QString, QList<Ticket>>& pools) const
+{
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    QJsonObject hosts;
+    for (auto it = pools.constBegin(); it != pools.constEnd(); ++it) {
+        QJsonArray tickets;
+        for (const Ticket& ticket : it.value()) {
+            if (ticket.expiresAt > now) {
+                tickets.append(QJsonObject{ { QStringLiteral("ticket"), QString::fromLatin1(ticket.ticket.toBase64()) },
+                                            { QStringLiteral("expiresAt"), ticket.expiresAt } });
+            }
+        }
+        if (!tickets.isEmpty()) {
+            hosts.insert(it.key(), tickets);
+        }
+    }
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        AbstractLogger::warning() << QStringLiteral("Could not write %1").arg(m_path);
+        return;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    file.write(QJsonDocument(hosts).toJson(QJsonDocument::Compact));
+    file.commit();
+}
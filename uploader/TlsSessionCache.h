@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef TLSSESSIONCACHE_H
+#define TLSSESSIONCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSslConfiguration>
+#include <QString>
+
+class QUrl;
+
+/**
+ * @brief TLS session tickets per host, kept across processes.
+ *
+ * A one-shot `flowshot up` starts with an empty TLS state and would do a full
+ * handshake on every run. With a ticket an earlier run received, the server
+ * can resume the session instead.
+ *
+ * Tickets are single use (RFC 8446, C.4): a server with anti-replay turns a
+ * reused one down, and it would link the connections that shared it. Each
+ * request takes its own ticket from a small pool per host, and gives it back
+ * if it ended up on a connection that was already open. New tickets go into
+ * the pool of the process that received them.
+ *
+ * A process claims a few tickets from `tls-sessions.json` in the config
+ * directory when it starts and returns the unused ones when it quits, both
+ * under a lock file, so concurrent processes never share one. The file is
+ * readable by the user only, since a ticket carries the session's secret.
+ * Safe to use from any thread.
+ */
+class TlsSessionCache
+{
+public:
+    static TlsSessionCache* instance();
+
+    // `base` with session persistence on and, if there is one, a ticket of its own
+    QSslConfiguration configurationFor(const QUrl& url, const QSslConfiguration& base);
+    /**
+     * @brief The request sent with `config` is done. Without a handshake it
+     * went over an open connection and its ticket goes back to the pool.
+     */
+    void release(const QUrl& url, const QSslConfiguration& config, bool handshake);
+    // Keep the ticket `config` received from the host of `url`
+    void store(const QUrl& url, const QSslConfiguration& config);
+    // Return the unused tickets to the file, for the next process
+    void flush();
+
+private:
+    struct Ticket
+    {
+        QByteArray ticket;
+        qint64 expiresAt = 0; // s since epoch
+    };
+
+    TlsSessionCache();
+
+    void claim();
+    QHash<QString, QList<Ticket>> readFile() const;
+    void writeFile(const QHash<QString, QList<Ticket>>& pools) const;
+    bool seen(const QByteArray& ticket);
+
+    QMutex m_mutex;
+    QString m_path;
+    QString m_lockPath;
+    // Unused tickets per host, newest last
+    QHash<QString, QList<Ticket>> m_pools;
+    // Handed to a request that hasn't connected yet
+    QHash<QByteArray, Ticket> m_reserved;
+    // Recently held tickets; every reply of a connection reports its ticket again
+    QList<QByteArray> m_seen;
+    bool m_dirty = false;
+};
+
+#endif // TLSSESSIONCACHE_H
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadCompressor.h"
+
+#include <QDir>
+#include <QFutureWatcher>
+#include <QMimeDatabase>
+#include <QMimeType>
+#include <QPromise>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <cmath>
+#include <memory>
+#include <zlib.h>
+
+#include "../utils/abstractlogger.h"
+
+// Payloads smaller than this aren't worth the detour
+static constexpr qint64 COMPRESSION_MIN_SIZE = 8 * 1024;
+// Entropy is sampled at this many evenly spread places
+static constexpr int COMPRESSION_SAMPLES = 4;
+static constexpr qint64 COMPRESSION_SAMPLE_SIZE = 16 * 1024;
+// Bits per byte above which data is assumed to be compressed already
+static constexpr double COMPRESSION_MAX_ENTROPY = 7.0;
+// The body is only sent compressed if it shrinks to at most this fraction
+static constexpr double COMPRESSION_MAX_RATIO = 0.9;
+static constexpr int COMPRESSION_LEVEL = 6;
+static constexpr qint64 COMPRESSION_BLOCK_SIZE = 256 * 1024;
+
+namespace {
+
+// A temporary file that is deleted with the source
+class TemporaryFileSource : public UploadSource
+{
+public:
+    explicit TemporaryFileSource(const QString& filePath)
+      : m_path(filePath)
+      , m_region(new FileRegionSource(filePath))
+    {
+    }
+
+    ~TemporaryFileSource() override
+    {
+        // Closed first, Windows can't delete open files
+        m_region.reset();
+        QFile::remove(m_path);
+    }
+
+    bool open() override { return m_region->open(); }
+    qint64 size() const override { return m_region->size(); }
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override
+    {
+        return m_region->readAt(offset, data, maxSize);
+    }
+    QString errorString() const override { return m_region->errorString(); }
+
+private:
+    QString m_path;
+    QScopedPointer<FileRegionSource> m_region;
+};
+
+bool deflateInto(z_stream& stream, int flush, QFile& file, QByteArray& out)
+{
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = uInt(out.size());
+        if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+            return false;
+        }
+        qint64 produced = out.size() - stream.avail_out;
+        if (file.write(out.constData(), produced) != produced) {
+            return false;
+        }
+    } while (stream.avail_out == 0);
+    return true;
+}
+
+QString gzipToTemporaryFile(const QList<QSharedPointer<UploadSource>>& parts,
+                            const std::function<bool()>& isCanceled)
+{
+    QTemporaryFile file(QDir::tempPath() + QStringLiteral("/flowshot-upload-XXXXXX.gz"));
+    file.setAutoRemove(false);
+    if (!file.open()) {
+        return {};
+    }
+
+    z_stream stream{};
+    // 16 + window bits selects the gzip wrapper
+    if (deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        file.remove();
+        return {};
+    }
+
+    QByteArray in(COMPRESSION_BLOCK_SIZE, Qt::Uninitialized);
+    QByteArray out(COMPRESSION_BLOCK_SIZE, Qt::Uninitialized);
+    bool ok = true;
+    for (const QSharedPointer<UploadSource>& part : parts) {
+        for (qint64 offset = 0; ok && offset < part->size();) {
+            if (isCanceled()) {
+                ok = false;
+                break;
+            }
+            qint64 read = part->readAt(offset, in.data(), in.size());
+            if (read <= 0) {
+                ok = false;
+                break;
+            }
+            offset += read;
+            stream.next_in = reinterpret_cast<Bytef*>(in.data());
+            stream.avail_in = uInt(read);
+            ok = deflateInto(stream, Z_NO_FLUSH, file, out);
+        }
+    }
+    ok = ok && deflateInto(stream, Z_FINISH, file, out);
+    deflateEnd(&stream);
+
+    if (!ok) {
+        file.remove();
+        return {};
+    }
+    return file.fileName();
+}
+
+} // namespace
+
+bool UploadCompressor::worthCompressing(const QString& mimeType, UploadSource& source)
+{
+    if (source.size() < COMPRESSION_MIN_SIZE) {
+        return false;
+    }
+
+    // Text, JSON, SVG and friends all derive from text/plain
+    QMimeType mime = QMimeDatabase().mimeTypeForName(mimeType);
+    if (mime.isValid() && !mime.isDefault() && !mime.inherits(QStringLiteral("text/plain"))) {
+        return false;
+    }
+
+    quint64 counts[256] = {};
+    qint64 sampled = 0;
+    QByteArray sample(COMPRESSION_SAMPLE_SIZE, Qt::Uninitialized);
+    for (int i = 0; i < COMPRESSION_SAMPLES; ++i) {
+        qint64 offset = source.size() / COMPRESSION_SAMPLES * i;
+        qint64 read = source.readAt(offset, sample.data(), sample.size());
+        for (qint64 j = 0; j < read; ++j) {
+            ++counts[quint8(sample.at(j))];
+        }
+        sampled += qMax<qint64>(0, read);
+    }
+    if (sampled == 0) {
+        return false;
+    }
+
+    double entropy = 0;
+    for (quint64 count : counts) {
+        if (count > 0) {
+            double p = double(count) / sampled;
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy <= COMPRESSION_MAX_ENTROPY;
+}
+
+QFuture<QSharedPointer<UploadSource>> UploadCompressor::compress(const QList<QSharedPointer<UploadSource>>& parts,
+                                                                 QObject* context,
+                                                                 std::function<void(QSharedPointer<UploadSource>)> done)
+{
+    qint64 inputSize = 0;
+    for (const QSharedPointer<UploadSource>& part : parts) {
+        inputSize += part->size();
+    }
+
+    // The watcher goes away with `context`, which drops the result safely
+    using Watcher = QFutureWatcher<QSharedPointer<UploadSource>>;
+    auto* watcher = new Watcher(context);
+    QObject::connect(watcher, &Watcher::finished, context, [watcher, done]() {
+        watcher->deleteLater();
+        if (watcher->isCanceled()) {
+            return;
+        }
+        done(watcher->future().resultCount() > 0 ? watcher->result() : QSharedPointer<UploadSource>());
+    });
+
+    auto promise = std::make_shared<QPromise<QSharedPointer<UploadSource>>>();
+    QFuture<QSharedPointer<UploadSource>> future = promise->future();
+    watcher->setFuture(future);
+
+    QThreadPool::globalInstance()->start([parts, inputSize, promise]() {
+        promise->start();
+        QSharedPointer<UploadSource> compressed;
+        // Cancelled while waiting for a pool thread, or while compressing
+        QString path = promise->isCanceled() ? QString() : gzipToTemporaryFile(parts, [&promise]() {
+            return promise->isCanceled();
+        });
+        if (!path.isEmpty()) {
+            compressed.reset(new TemporaryFileSource(path));
+            if (!compressed->open() || compressed->size() > inputSize * COMPRESSION_MAX_RATIO) {
+                compressed.reset();
+            } else {
+                AbstractLogger::info() << QStringLiteral("Compressed upload body from %1 to %2 bytes")
+                                            .arg(inputSize)
+                                            .arg(compressed->size());
+            }
+        }
+
+        promise->addResult(compressed);
+        promise->finish();
+    });
+    return future;
+}
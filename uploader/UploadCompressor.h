@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADCOMPRESSOR_H
+#define UPLOADCOMPRESSOR_H
+
+#include <QFuture>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <functional>
+
+#include "UploadSource.h"
+
+class QObject;
+
+/**
+ * @brief gzip content-encoding for request bodies that compress well.
+ *
+ * Whether a payload is worth it is decided by its MIME type (text-like or
+ * unknown) and a sample of its byte entropy, so media and archives are sent
+ * as they are.
+ *
+ * Compression streams the body in blocks through zlib on a pool thread into
+ * a temporary file, so memory use doesn't grow with the payload. The result
+ * has a known size and can be re-read for retries like any other file.
+ */
+class UploadCompressor
+{
+public:
+    static bool worthCompressing(const QString& mimeType, UploadSource& source);
+
+    /**
+     * @brief gzip the concatenation of `parts` on a pool thread.
+     *
+     * `done` runs on the thread of `context` with the compressed body, or
+     * null if compression failed or didn't save enough. It is dropped if
+     * `context` is destroyed first. The parts must not be read elsewhere in
+     * the meantime.
+     *
+     * Cancelling the returned future stops the work at the next block,
+     * removes the temporary file and drops `done`.
+     */
+    static QFuture<QSharedPointer<UploadSource>> compress(const QList<QSharedPointer<UploadSource>>& parts,
+                         QObject* context,
+                         std::function<void(QSharedPointer<UploadSource>)> done);
+};
+
+#endif // UPLOADCOMPRESSOR_H
@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadDedupCache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QLockFile>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtEndian>
+#include <memory>
+
+#include "UploadSource.h"
+#include "../utils/abstractlogger.h"
+
+namespace {
+
+// Version 1 entries weren't scoped, they are dropped on load
+const QByteArray LOG_MAGIC = QByteArrayLiteral("FSDC\x02");
+
+constexpr int HASH_SIZE = 32;        // Blake2b-256
+constexpr int KEY_SIZE = 2 * HASH_SIZE;
+constexpr int FINGERPRINT_SIZE = 20; // SHA-1
+constexpr qint64 HASH_BLOCK_SIZE = 1024 * 1024;
+// Don't bother compacting small logs
+constexpr qint64 COMPACT_MIN_RECORDS = 4096;
+constexpr int LOCK_TIMEOUT_MS = 5000;
+
+// Record layout, integers little endian:
+//   Entry:       type, scope[32], hash[32], storedAt i64, urlLength u16, url (UTF-8)
+//   Fingerprint: type, fingerprint[20], hash[32]
+//   Remove:      type, scope[32], hash[32]
+enum RecordType : quint8
+{
+    RecordEntry = 1,
+    RecordFingerprint = 2,
+    RecordRemove = 3,
+};
+
+template<typename T>
+void appendInt(QByteArray& out, T value)
+{
+    char bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, sizeof(T));
+}
+
+QByteArray entryRecord(const QByteArray& key, const QString& url, qint64 storedAt)
+{
+    QByteArray utf8 = url.toUtf8().left(0xffff);
+    QByteArray record;
+    record.reserve(1 + KEY_SIZE + 8 + 2 + utf8.size());
+    record.append(char(RecordEntry));
+    record.append(key);
+    appendInt<qint64>(record, storedAt);
+    appendInt<quint16>(record, quint16(utf8.size()));
+    record.append(utf8);
+    return record;
+}
+
+QByteArray fingerprintRecord(const QByteArray& fingerprint, const QByteArray& hash)
+{
+    return char(RecordFingerprint) + fingerprint + hash;
+}
+
+QByteArray removeRecord(const QByteArray& key)
+{
+    return char(RecordRemove) + key;
+}
+
+QByteArray entryKey(const QByteArray& scope, const QByteArray& contentHash)
+{
+    if (scope.size() != HASH_SIZE || contentHash.size() != HASH_SIZE) {
+        return {};
+    }
+    return scope + contentHash;
+}
+
+} // namespace
+
+UploadDedupCache::UploadDedupCache()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(dir);
+    m_path = dir + QStringLiteral("/upload-dedup.log");
+    m_lockPath = m_path + QStringLiteral(".lock");
+}
+
+UploadDedupCache* UploadDedupCache::instance()
+{
+    static UploadDedupCache cache;
+    return &cache;
+}
+
+QByteArray UploadDedupCache::scope(const QStringList& identity)
+{
+    // Hashed, so the token doesn't end up in the cache file
+    return QCryptographicHash::hash(identity.join(QLatin1Char('\n')).toUtf8(), HashAlgorithm);
+}
+
+/**
+ * @brief Hash a whole source up front. In-memory sources are hashed in place,
+ * anything else is read in blocks. `isCanceled` is checked between blocks.
+ */
+QByteArray UploadDedupCache::hashSource(UploadSource& source, const std::function<bool()>& isCanceled)
+{
+    QCryptographicHash hash(HashAlgorithm);
+    if (const char* data = source.constData()) {
+        for (qint64 offset = 0; offset < source.size(); offset += HASH_BLOCK_SIZE) {
+            if (isCanceled && isCanceled()) {
+                return {};
+            }
+            hash.addData(QByteArrayView(data + offset, qMin(HASH_BLOCK_SIZE, source.size() - offset)));
+        }
+        return hash.result();
+    }
+
+    QByteArray block(qMin(source.size(), HASH_BLOCK_SIZE), Qt::Uninitialized);
+    qint64 offset = 0;
+    while (offset < source.size()) {
+        if (isCanceled && isCanceled()) {
+            return {};
+        }
+        qint64 read = source.readAt(offset, block.data(), block.size());
+        if (read <= 0) {
+            return {};
+        }
+        hash.addData(QByteArrayView(block.constData(), read));
+        offset += read;
+    }
+    return hash.result();
+}
+
+QFuture<QByteArray> UploadDedupCache::hashSourceAsync(const QSharedPointer<UploadSource>& source,
+                                                      QObject* context,
+                                                      std::function<void(QByteArray)> done)
+{
+    // The watcher goes away with `context`, which drops the result safely
+    auto* watcher = new QFutureWatcher<QByteArray>(context);
+    QObject::connect(watcher, &QFutureWatcher<QByteArray>::finished, context, [watcher, done]() {
+        watcher->deleteLater();
+        if (watcher->isCanceled()) {
+            return;
+        }
+        done(watcher->future().resultCount() > 0 ? watcher->result() : QByteArray());
+    });
+
+    auto promise = std::make_shared<QPromise<QByteArray>>();
+    QFuture<QByteArray> future = promise->future();
+    watcher->setFuture(future);
+
+    QThreadPool::globalInstance()->start([source, promise]() {
+        promise->start();
+        promise->addResult(hashSource(*source, [&promise]() {
+            return promise->isCanceled();
+        }));
+        promise->finish();
+    });
+    return future;
+}
+
+QString UploadDedupCache::lookup(const QByteArray& scope, const QByteArray& contentHash, qint64 maxAgeSecs)
+{
+    QByteArray key = entryKey(scope, contentHash);
+    if (key.isEmpty()) {
+        return {};
+    }
+
+    QMutexLocker locker(&m_mutex);
+    load();
+
+    auto it = m_entries.constFind(key);
+    if (it == m_entries.constEnd()) {
+        return {};
+    }
+    if (maxAgeSecs > 0 &&
+        QDateTime::currentSecsSinceEpoch() - it->storedAt > maxAgeSecs) {
+        return {};
+    }
+    return it->url;
+}
+
+QByteArray UploadDedupCache::hashForFingerprint(const QByteArray& fingerprint)
+{
+    QMutexLocker locker(&m_mutex);
+    load();
+    return m_fingerprints.value(fingerprint);
+}
+
+void UploadDedupCache::insert(const QByteArray& scope,
+                              const QByteArray& contentHash,
+                              const QString& url,
+                              const QByteArray& fingerprint)
+{
+    QByteArray key = entryKey(scope, contentHash);
+    if (key.isEmpty() || url.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    load();
+
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    m_entries.insert(key, { url, now });
+    QByteArray records = entryRecord(key, url, now);
+
+    if (fingerprint.size() == FINGERPRINT_SIZE &&
+        m_fingerprints.value(fingerprint) != contentHash) {
+        m_fingerprints.insert(fingerprint, contentHash);
+        records.append(fingerprintRecord(fingerprint, contentHash));
+    }
+    append(records);
+}
+
+void UploadDedupCache::remove(const QByteArray& scope, const QByteArray& contentHash)
+{
+    QByteArray key = entryKey(scope, contentHash);
+    QMutexLocker locker(&m_mutex);
+    load();
+
+    if (!key.isEmpty() && m_entries.remove(key)) {
+        append(removeRecord(key));
+    }
+}
+
+void UploadDedupCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    QLockFile lock(m_lockPath);
+    if (!lock.tryLock(LOCK_TIMEOUT_MS)) {
+        AbstractLogger::warning() << QStringLiteral("Upload dedup cache: %1 is locked, reading it anyway").arg(m_path);
+    }
+
+    QFile file(m_path);
+    QByteArray data;
+    if (file.open(QIODevice::ReadOnly)) {
+        data = file.readAll();
+        file.close();
+    }
+
+    qsizetype pos = 0;
+    qsizetype validUntil = 0;
+    if (data.startsWith(LOG_MAGIC)) {
+        pos = validUntil = LOG_MAGIC.size();
+        const char* bytes = data.constData();
+        const qsizetype size = data.size();
+
+        while (pos < size) {
+            quint8 type = quint8(bytes[pos]);
+            qsizetype p = pos + 1;
+
+            if (type == RecordEntry) {
+                if (p + KEY_SIZE + 10 > size) {
+                    break;
+                }
+                QByteArray key(bytes + p, KEY_SIZE);
+                p += KEY_SIZE;
+                qint64 storedAt = qFromLittleEndian<qint64>(bytes + p);
+                p += 8;
+                quint16 urlLength = qFromLittleEndian<quint16>(bytes + p);
+                p += 2;
+                if (p + urlLength > size) {
+                    break;
+                }
+                m_entries.insert(key, { QString::fromUtf8(bytes + p, urlLength), storedAt });
+                p += urlLength;
+            } else if (type == RecordFingerprint) {
+                if (p + FINGERPRINT_SIZE + HASH_SIZE > size) {
+                    break;
+                }
+                m_fingerprints.insert(QByteArray(bytes + p, FINGERPRINT_SIZE),
+                                      QByteArray(bytes + p + FINGERPRINT_SIZE, HASH_SIZE));
+                p += FINGERPRINT_SIZE + HASH_SIZE;
+            } else if (type == RecordRemove) {
+                if (p + KEY_SIZE > size) {
+                    break;
+                }
+                m_entries.remove(QByteArray(bytes + p, KEY_SIZE));
+                p += KEY_SIZE;
+            } else {
+                break;
+            }
+
+            pos = validUntil = p;
+            ++m_records;
+        }
+    }
+
+    if (validUntil != data.size()) {
+        AbstractLogger::warning() << QStringLiteral(
+                                       "Upload dedup cache: discarding %1 unreadable bytes")
+                                       .arg(data.size() - validUntil);
+    }
+
+    // Fingerprints whose content has no entry in any scope are dead weight
+    QSet<QByteArray> contentHashes;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        contentHashes.insert(it.key().right(HASH_SIZE));
+    }
+    for (auto it = m_fingerprints.begin(); it != m_fingerprints.end();) {
+        it = contentHashes.contains(it.value()) ? std::next(it) : m_fingerprints.erase(it);
+    }
+
+    // Only with the lock held, another process appends to the old file otherwise
+    qint64 live = m_entries.size() + m_fingerprints.size();
+    if (lock.isLocked() && (validUntil == 0 || validUntil != data.size() ||
+                            (m_records > COMPACT_MIN_RECORDS && m_records > 2 * live))) {
+        compact();
+    }
+}
+
+/**
+ * @brief Rewrite the log with only the live records. The caller holds the
+ * lock.
+ */
+void UploadDedupCache::compact()
+{
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        AbstractLogger::warning() << QStringLiteral("Upload dedup cache: can't write %1: %2")
+                                       .arg(m_path, file.errorString());
+        return;
+    }
+
+    QByteArray out = LOG_MAGIC;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        out.append(entryRecord(it.key(), it->url, it->storedAt));
+    }
+    for (auto it = m_fingerprints.constBegin(); it != m_fingerprints.constEnd(); ++it) {
+        out.append(fingerprintRecord(it.key(), it.value()));
+    }
+    file.write(out);
+    if (!file.commit()) {
+        AbstractLogger::warning() << QStringLiteral("Upload dedup cache: can't write %1: %2")
+                                       .arg(m_path, file.errorString());
+        return;
+    }
+
+    m_records = m_entries.size() + m_fingerprints.size();
+}
+
+void UploadDedupCache::append(const QByteArray& records)
+{
+    QLockFile lock(m_lockPath);
+    if (!lock.tryLock(LOCK_TIMEOUT_MS)) {
+        // Only a compaction could lose the records, and none runs without the lock
+        AbstractLogger::warning() << QStringLiteral("Upload dedup cache: %1 is locked, appending anyway").arg(m_path);
+    }
+
+    // Opened per write, a handle kept open would write into a replaced file
+    QFile log(m_path);
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return;
+    }
+    // One write, so a crash can at worst tear the last record
+    log.write(records);
+    ++m_records;
+}
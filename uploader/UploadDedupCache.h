@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADDEDUPCACHE_H
+#define UPLOADDEDUPCACHE_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QObject;
+class UploadSource;
+
+/**
+ * @brief Persistent index from content hash to the URL it was uploaded to.
+ *
+ * URLs are kept per scope, the backend, server and account they were
+ * uploaded to (see `scope()`), so switching any of them never hands out a
+ * URL that belongs elsewhere. A second index maps file fingerprints (path, size, mtime) to content
+ * hashes, so an unchanged file is recognised without reading it again.
+ *
+ * Both live in memory for O(1) lookups and are persisted to an append-only
+ * binary log in the cache directory. Every change is one small record; the
+ * log is rewritten without dead records once they outnumber the live ones.
+ * A torn record at the end, left by a crash, is cut off on load. Processes
+ * share the log through a lock file next to it, like the upload journal.
+ *
+ * Safe to use from any thread.
+ */
+class UploadDedupCache
+{
+public:
+    static constexpr QCryptographicHash::Algorithm HashAlgorithm = QCryptographicHash::Blake2b_256;
+
+    static UploadDedupCache* instance();
+
+    // Identifies a backend, server and account, e.g. { "privateuploader", server, token }
+    static QByteArray scope(const QStringList& identity);
+
+    // Empty if the source can't be read or `isCanceled` returns true meanwhile
+    static QByteArray hashSource(UploadSource& source, const std::function<bool()>& isCanceled = {});
+    /**
+     * @brief hashSource() on a pool thread. `done` runs on the thread of
+     * `context` with the hash, and is dropped if `context` is destroyed or
+     * the returned future cancelled first. The source must not be read
+     * elsewhere in the meantime.
+     */
+    static QFuture<QByteArray> hashSourceAsync(const QSharedPointer<UploadSource>& source,
+                                               QObject* context,
+                                               std::function<void(QByteArray)> done);
+
+    /**
+     * @brief The URL uploaded within `scope` for `contentHash`, or empty when
+     * unknown or older than `maxAgeSecs` (0 = no limit).
+     */
+    QString lookup(const QByteArray& scope, const QByteArray& contentHash, qint64 maxAgeSecs);
+    QByteArray hashForFingerprint(const QByteArray& fingerprint);
+
+    void insert(const QByteArray& scope,
+                const QByteArray& contentHash,
+                const QString& url,
+                const QByteArray& fingerprint = {});
+    void remove(const QByteArray& scope, const QByteArray& contentHash);
+
+private:
+    UploadDedupCache();
+
+    struct Entry
+    {
+        QString url;
+        qint64 storedAt;
+    };
+
+    void load();
+    void compact();
+    void append(const QByteArray& records);
+
+    QMutex m_mutex;
+    bool m_loaded = false;
+    QString m_path;
+    QString m_lockPath;
+    qint64 m_records = 0;
+    // Keyed by scope + content hash
+    QHash<QByteArray, Entry> m_entries;
+    QHash<QByteArray, QByteArray> m_fingerprints;
+};
+
+#endif // UPLOADDEDUPCACHE_H
@@ -0,0 +1,517 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadJournal.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLockFile>
+#include <QNetworkInformation>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUrl>
+#include <QUuid>
+
+#include "imguploadermanager.h"
+#include "../utils/ConfigHandler.h"
+#include "../utils/abstractlogger.h"
+#include "../utils/filenamehandler.h"
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Give up on a job after this many failed background attempts
+constexpr int MAX_ATTEMPTS = 20;
+constexpr int RETRY_BASE_MS = 30 * 1000;
+constexpr int RETRY_MAX_MS = 30 * 60 * 1000;
+// Appends are tiny, a holder this slow is stuck
+constexpr int LOCK_TIMEOUT_MS = 5000;
+// Finished records tolerated before the journal is rewritten
+constexpr int COMPACT_SLACK = 256;
+
+/**
+ * @brief When a process started, in clock ticks since boot, or -1 if unknown.
+ * Tells the owner of a job from an unrelated process that reuses its pid.
+ */
+qint64 processStartTime(qint64 pid)
+{
+#ifdef Q_OS_LINUX
+    QFile stat(QStringLiteral("/proc/%1/stat").arg(pid));
+    if (!stat.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    QByteArray line = stat.readAll();
+    // The command name in parentheses may contain spaces, the fields after it
+    // start with the 3rd, starttime is the 22nd
+    QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    return fields.size() > 19 ? fields.at(19).toLongLong() : -1;
+#else
+    Q_UNUSED(pid)
+    return -1;
+#endif
+}
+
+qint64 ownStartTime()
+{
+    static const qint64 start = processStartTime(QCoreApplication::applicationPid());
+    return start;
+}
+
+} // namespace
+
+UploadJournal::UploadJournal()
+  : QObject(nullptr)
+  , m_retryTimer(new QTimer(this))
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    m_path = dir + QStringLiteral("/upload-journal.jsonl");
+    m_lockPath = m_path + QStringLiteral(".lock");
+
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &UploadJournal::drain);
+
+    if (QNetworkInformation::loadDefaultBackend()) {
+        connect(QNetworkInformation::instance(),
+                &QNetworkInformation::reachabilityChanged,
+                this,
+                [this](QNetworkInformation::Reachability reachability) {
+                    if (reachability == QNetworkInformation::Reachability::Online) {
+                        m_failureStreak = 0;
+                        drain();
+                    }
+                });
+    }
+
+    load();
+}
+
+UploadJournal* UploadJournal::instance()
+{
+    static UploadJournal* journal = new UploadJournal();
+    return journal;
+}
+
+QString UploadJournal::enqueue(const QString& filePath, bool temporary)
+{
+    Job job{ QUuid::createUuid().toString(QUuid::WithoutBraces),
+             QFileInfo(filePath).absoluteFilePath(),
+             temporary,
+             QCoreApplication::applicationPid(),
+             ownStartTime(),
+             0,
+             false };
+    m_jobs.append(job);
+    m_owned.insert(job.id);
+
+    append({ { QStringLiteral("op"), QStringLiteral("queued") },
+             { QStringLiteral("id"), job.id },
+             { QStringLiteral("path"), job.filePath },
+             { QStringLiteral("temp"), job.temporary },
+             { QStringLiteral("pid"), job.pid },
+             { QStringLiteral("pstart"), job.processStart },
+             { QStringLiteral("at"), QDateTime::currentSecsSinceEpoch() } },
+           true);
+    return job.id;
+}
+
+void UploadJournal::markStarted(const QString& id)
+{
+    int index = jobIndex(id);
+    if (index >= 0 && m_owned.contains(id) && !m_jobs.at(index).started) {
+        appendStarted(m_jobs[index]);
+    }
+}
+
+/**
+ * @brief Record that this process is uploading the job. A drained job
+ * changes hands with it, so no other process picks it up as well.
+ */
+void UploadJournal::appendStarted(Job& job)
+{
+    job.pid = QCoreApplication::applicationPid();
+    job.processStart = ownStartTime();
+    job.started = true;
+    append({ { QStringLiteral("op"), QStringLiteral("started") },
+             { QStringLiteral("id"), job.id },
+             { QStringLiteral("pid"), job.pid },
+             { QStringLiteral("pstart"), job.processStart } },
+           false);
+}
+
+void UploadJournal::markDone(const QString& id, const QString& url)
+{
+    int index = jobIndex(id);
+    if (index < 0) {
+        return;
+    }
+    m_jobs.removeAt(index);
+    m_owned.remove(id);
+
+    append({ { QStringLiteral("op"), QStringLiteral("done") },
+             { QStringLiteral("id"), id },
+             { QStringLiteral("url"), url } },
+           true);
+}
+
+void UploadJournal::release(const QString& id)
+{
+    if (!m_owned.remove(id) || jobIndex(id) < 0) {
+        return;
+    }
+    AbstractLogger::info() << QStringLiteral("Upload %1 left unfinished, retrying in the background")
+                                .arg(id);
+    scheduleRetry();
+}
+
+void UploadJournal::drop(const QString& id)
+{
+    int index = jobIndex(id);
+    if (index < 0) {
+        return;
+    }
+    m_jobs.removeAt(index);
+    m_owned.remove(id);
+
+    append({ { QStringLiteral("op"), QStringLiteral("dropped") },
+             { QStringLiteral("id"), id } },
+           false);
+}
+
+bool UploadJournal::cancel(const QString& id)
+{
+    int index = jobIndex(id);
+    if (index < 0 || m_owned.contains(id)) {
+        return false;
+    }
+    Job job = m_jobs.at(index);
+
+    // Takes the upload and a result already on its way with it
+    delete m_draining.take(id);
+    drop(id);
+    if (job.temporary) {
+        QFile::remove(job.filePath);
+    }
+    AbstractLogger::info() << QStringLiteral("Cancelled queued upload %1").arg(job.filePath);
+
+    // Its slot is free for the next job
+    drain();
+    return true;
+}
+
+int UploadJournal::pendingCount() const
+{
+    return m_jobs.size();
+}
+
+QJsonArray UploadJournal::pending() const
+{
+    QJsonArray jobs;
+    for (const Job& job : m_jobs) {
+        bool uploading = job.started && (m_owned.contains(job.id) || m_draining.contains(job.id) ||
+                                         ownedElsewhere(job));
+        jobs.append(QJsonObject{ { QStringLiteral("id"), job.id },
+                                 { QStringLiteral("path"), job.filePath },
+                                 { QStringLiteral("attempts"), job.attempts },
+                                 { QStringLiteral("state"),
+                                   uploading ? QStringLiteral("uploading") : QStringLiteral("queued") } });
+    }
+    return jobs;
+}
+
+/**
+ * @brief Upload pending jobs nobody else is working on, up to the configured
+ * number of concurrent uploads.
+ */
+void UploadJournal::drain()
+{
+    if (QNetworkInformation* network = QNetworkInformation::instance()) {
+        if (network->reachability() == QNetworkInformation::Reachability::Disconnected) {
+            // reachabilityChanged restarts the drain
+            return;
+        }
+    }
+
+    // Other processes may have queued, released or finished jobs meanwhile
+    replay();
+
+    int maxConcurrent = ConfigHandler().uploadMaxConcurrent();
+    bool waiting = false;
+    const QList<Job> jobs = m_jobs;
+    for (const Job& job : jobs) {
+        if (m_draining.size() >= maxConcurrent) {
+            break;
+        }
+        if (m_owned.contains(job.id) || m_draining.contains(job.id)) {
+            continue;
+        }
+        if (ownedElsewhere(job)) {
+            waiting = true;
+            continue;
+        }
+        if (!QFile::exists(job.filePath)) {
+            AbstractLogger::warning() << QStringLiteral("Dropping queued upload, file is gone: %1")
+                                           .arg(job.filePath);
+            drop(job.id);
+            continue;
+        }
+        startJob(job);
+    }
+
+    // Nobody tells this process when the other one lets go of its jobs
+    if (waiting) {
+        scheduleRetry();
+    }
+}
+
+void UploadJournal::startJob(const Job& job)
+{
+    AbstractLogger::info() << QStringLiteral("Uploading queued file %1 (attempt %2)")
+                                .arg(job.filePath)
+                                .arg(job.attempts + 1);
+
+    QString fileName = job.temporary ? FileNameHandler().parsedPattern() + ".png"
+                                     : FileNameHandler().parseFilename(QFileInfo(job.filePath).fileName());
+
+    if (int index = jobIndex(job.id); index >= 0) {
+        appendStarted(m_jobs[index]);
+    }
+
+    // The backend may have changed since the job was queued, it goes where
+    // uploads go now
+    auto* context = new QObject(this);
+    m_draining.insert(job.id, context);
+    QString id = job.id;
+    QString filePath = job.filePath;
+    bool temporary = job.temporary;
+
+    ImgUploaderManager().uploadInBackground(
+      filePath,
+      context,
+      [this, context, id, filePath, temporary](const QUrl& url, const QString& error) {
+          context->deleteLater();
+          if (url.isEmpty()) {
+              AbstractLogger::warning() << QStringLiteral("Queued upload of %1 failed: %2").arg(filePath, error);
+              jobFinished(id, false);
+              return;
+          }
+          AbstractLogger::info() << QStringLiteral("Uploaded queued file %1: %2").arg(filePath, url.toString());
+          markDone(id, url.toString());
+          if (temporary) {
+              QFile::remove(filePath);
+          }
+          emit drained(filePath, url.toString());
+          jobFinished(id, true);
+      },
+      fileName);
+}
+
+void UploadJournal::jobFinished(const QString& id, bool success)
+{
+    m_draining.remove(id);
+
+    if (success) {
+        m_failureStreak = 0;
+        drain();
+        return;
+    }
+
+    int index = jobIndex(id);
+    if (index >= 0) {
+        Job& job = m_jobs[index];
+        ++job.attempts;
+        append({ { QStringLiteral("op"), QStringLiteral("failed") },
+                 { QStringLiteral("id"), id } },
+               false);
+        if (job.attempts >= MAX_ATTEMPTS) {
+            AbstractLogger::error() << QStringLiteral("Giving up on queued upload %1 after %2 attempts")
+                                         .arg(job.filePath)
+                                         .arg(job.attempts);
+            drop(id);
+        }
+    }
+
+    ++m_failureStreak;
+    scheduleRetry();
+}
+
+void UploadJournal::scheduleRetry()
+{
+    if (m_retryTimer->isActive()) {
+        return;
+    }
+    int shift = qMin(m_failureStreak, 6);
+    m_retryTimer->start(qMin(RETRY_BASE_MS << shift, RETRY_MAX_MS));
+}
+
+int UploadJournal::jobIndex(const QString& id) const
+{
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs.at(i).id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Whether another running Flowshot process queued the job and may
+ * still be uploading it.
+ */
+bool UploadJournal::ownedElsewhere(const Job& job) const
+{
+    // Jobs of this process are in m_owned, the rest are a dead predecessor's
+    if (job.pid == QCoreApplication::applicationPid()) {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    if (job.pid <= 0 || ::kill(pid_t(job.pid), 0) != 0) {
+        return false;
+    }
+    // A live pid may have been reused since
+    return job.processStart < 0 || processStartTime(job.pid) == job.processStart;
+#else
+    return false;
+#endif
+}
+
+void UploadJournal::load()
+{
+    replay();
+    if (!m_jobs.isEmpty()) {
+        AbstractLogger::info() << QStringLiteral("Upload journal: %1 unfinished upload(s)").arg(m_jobs.size());
+    }
+}
+
+/**
+ * @brief Rebuild the pending jobs from the journal, with whatever other
+ * processes appended since the last look.
+ */
+void UploadJournal::replay()
+{
+    QLockFile lock(m_lockPath);
+    if (!lock.tryLock(LOCK_TIMEOUT_MS)) {
+        AbstractLogger::warning() << QStringLiteral("Upload journal: %1 is locked, reading it anyway").arg(m_path);
+    }
+
+    // Every change of ours was appended too, the file is the whole state
+    m_jobs.clear();
+    int records = 0;
+    QFile file(m_path);
+    if (file.open(QIODevice::ReadOnly)) {
+        while (!file.atEnd()) {
+            QJsonObject record = QJsonDocument::fromJson(file.readLine()).object();
+            QString op = record.value(QStringLiteral("op")).toString();
+            QString id = record.value(QStringLiteral("id")).toString();
+            if (id.isEmpty()) {
+                continue;
+            }
+            ++records;
+
+            if (op == QLatin1String("queued")) {
+                m_jobs.append({ id,
+                                record.value(QStringLiteral("path")).toString(),
+                                record.value(QStringLiteral("temp")).toBool(),
+                                record.value(QStringLiteral("pid")).toInteger(),
+                                record.value(QStringLiteral("pstart")).toInteger(-1),
+                                record.value(QStringLiteral("attempts")).toInt(),
+                                record.value(QStringLiteral("started")).toBool() });
+            } else if (op == QLatin1String("started")) {
+                int index = jobIndex(id);
+                if (index >= 0) {
+                    Job& job = m_jobs[index];
+                    job.pid = record.value(QStringLiteral("pid")).toInteger();
+                    job.processStart = record.value(QStringLiteral("pstart")).toInteger(-1);
+                    job.started = true;
+                }
+            } else if (op == QLatin1String("failed")) {
+                int index = jobIndex(id);
+                if (index >= 0) {
+                    ++m_jobs[index].attempts;
+                }
+            } else if (op == QLatin1String("done") || op == QLatin1String("dropped")) {
+                int index = jobIndex(id);
+                if (index >= 0) {
+                    m_jobs.removeAt(index);
+                }
+            }
+        }
+        file.close();
+    }
+
+    // Finished elsewhere, or owned by a window that is gone
+    const QSet<QString> owned = m_owned;
+    for (const QString& id : owned) {
+        if (jobIndex(id) < 0) {
+            m_owned.remove(id);
+        }
+    }
+
+    // Another process appends through the old file otherwise
+    if (lock.isLocked() && records > m_jobs.size() + COMPACT_SLACK) {
+        compact();
+    }
+}
+
+/**
+ * @brief Rewrite the journal with one `queued` record per pending job. The
+ * caller holds the lock.
+ */
+void UploadJournal::compact()
+{
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    for (const Job& job : std::as_const(m_jobs)) {
+        QJsonObject record{ { QStringLiteral("op"), QStringLiteral("queued") },
+                            { QStringLiteral("id"), job.id },
+                            { QStringLiteral("path"), job.filePath },
+                            { QStringLiteral("temp"), job.temporary },
+                            { QStringLiteral("pid"), job.pid },
+                            { QStringLiteral("pstart"), job.processStart },
+                            { QStringLiteral("attempts"), job.attempts },
+                            { QStringLiteral("started"), job.started } };
+        file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    }
+    if (!file.commit()) {
+        AbstractLogger::warning() << QStringLiteral("Upload journal: can't write %1: %2")
+                                       .arg(m_path, file.errorString());
+    }
+}
+
+void UploadJournal::append(const QJsonObject& record, bool sync)
+{
+    QLockFile lock(m_lockPath);
+    if (!lock.tryLock(LOCK_TIMEOUT_MS)) {
+        // Only a compaction could lose the record, and none runs without the lock
+        AbstractLogger::warning() << QStringLiteral("Upload journal: %1 is locked, appending anyway").arg(m_path);
+    }
+
+    // Opened per record, a handle kept open would write into a replaced file
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        AbstractLogger::warning() << QStringLiteral("Upload journal: can't open %1: %2")
+                                       .arg(m_path, file.errorString());
+        return;
+    }
+    // One write per line, a crash can at worst tear the last line
+    file.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+    file.flush();
+#ifdef Q_OS_UNIX
+    if (sync) {
+        ::fsync(file.handle());
+    }
+#else
+    Q_UNUSED(sync)
+#endif
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADJOURNAL_H
+#define UPLOADJOURNAL_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class QTimer;
+
+/**
+ * @brief Append-only on-disk journal of file uploads, so that queued and
+ * in-flight work survives a crash or suspend.
+ *
+ * Every state change is one JSON line in the app data directory:
+ * `queued` when an upload is handed to the uploader, `started` once its bytes
+ * are on the wire (with the process uploading it), `done` once it has a URL,
+ * `dropped` when it is abandoned. A job without `done` or `dropped` is
+ * pending. The journal is replayed on first use and before every drain, so
+ * records other processes appended are seen; a torn last line is skipped.
+ *
+ * Several processes share the journal, so every access holds a lock file
+ * next to it. Records are appended through a fresh handle each time, and the
+ * journal is only rewritten with the pending jobs while the lock is held and
+ * once it is mostly finished records.
+ *
+ * Jobs that outlived their process, and jobs whose upload window was closed
+ * without a URL, are uploaded by `drain()` in the background through the
+ * configured `uploaderBackend`, a few at a time, backing off while the API is
+ * unreachable.
+ *
+ * Lives on the GUI thread.
+ */
+class UploadJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    static UploadJournal* instance();
+
+    /**
+     * @brief Record a new upload owned by this process. `temporary` files are
+     * deleted once uploaded.
+     * @return The job id.
+     */
+    QString enqueue(const QString& filePath, bool temporary);
+    // The upload of an owned job is in flight
+    void markStarted(const QString& id);
+    void markDone(const QString& id, const QString& url);
+    // The owner gave up on the job, leave it to the drain
+    void release(const QString& id);
+    void drop(const QString& id);
+    /**
+     * @brief Abort a job the drain is uploading or waiting to upload, and
+     * drop it. A temporary file is deleted.
+     * @return false for unknown jobs and jobs owned by an upload window or
+     * a batch, which are cancelled through their owner.
+     */
+    bool cancel(const QString& id);
+
+    void drain();
+    int pendingCount() const;
+    // `{id, path, attempts, state}` per pending job, state is "uploading" or "queued"
+    QJsonArray pending() const;
+
+signals:
+    void drained(const QString& filePath, const QString& url);
+
+private:
+    explicit UploadJournal();
+
+    struct Job
+    {
+        QString id;
+        QString filePath;
+        bool temporary;
+        // The process that queued or is uploading the job
+        qint64 pid;
+        qint64 processStart;
+        int attempts;
+        bool started;
+    };
+
+    void load();
+    void replay();
+    void compact();
+    void appendStarted(Job& job);
+    void append(const QJsonObject& record, bool sync);
+    void startJob(const Job& job);
+    void jobFinished(const QString& id, bool success);
+    void scheduleRetry();
+    int jobIndex(const QString& id) const;
+    bool ownedElsewhere(const Job& job) const;
+
+    QString m_path;
+    QString m_lockPath;
+    QList<Job> m_jobs;
+    // Jobs uploaded by a live widget of this process
+    QSet<QString> m_owned;
+    // Jobs currently uploaded by the drain, deleting the object aborts the upload
+    QHash<QString, QObject*> m_draining;
+    QTimer* m_retryTimer;
+    int m_failureStreak = 0;
+};
+
+#endif // UPLOADJOURNAL_H
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadNetwork.h"
+
+#include <QCoreApplication>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSslConfiguration>
+#include <QThread>
+#include <QTimer>
+#include <memory>
+
+#include "ApiEndpointPool.h"
+#include "TlsSessionCache.h"
+#include "UploadScheduler.h"
+#include "../utils/ConfigHandler.h"
+#include "../utils/abstractlogger.h"
+
+// Don't open another connection if one was opened this recently
+static constexpr qint64 PREWARM_MIN_INTERVAL_MS = 10 * 1000;
+
+// Passes every request and reply through UploadNetwork
+class UploadAccessManager : public QNetworkAccessManager
+{
+public:
+    explicit UploadAccessManager(UploadNetwork* network)
+      : QNetworkAccessManager(network)
+      , m_network(network)
+    {
+    }
+
+protected:
+    QNetworkReply* createRequest(Operation op,
+                                 const QNetworkRequest& originalRequest,
+                                 QIODevice* outgoingData) override
+    {
+        QNetworkRequest request = originalRequest;
+        m_network->prepareRequest(request);
+        QNetworkReply* reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+        m_network->watchReply(reply);
+        return reply;
+    }
+
+private:
+    UploadNetwork* m_network;
+};
+
+UploadNetwork::UploadNetwork()
+  : QObject(nullptr)
+  , m_thread(new QThread())
+  , m_NetworkAM(new UploadAccessManager(this))
+  , m_keepWarmTimer(new QTimer(this))
+{
+    connect(m_keepWarmTimer, &QTimer::timeout, this, [this]() {
+        // A running upload keeps its connection warm by itself
+        if (UploadScheduler::instance()->runningCount() == 0) {
+            connectTo(QUrl(ApiEndpointPool::instance()->preferred()));
+        }
+    });
+
+    m_thread->setObjectName(QStringLiteral("FlowshotUploadNetwork"));
+    moveToThread(m_thread);
+
+    reloadConfig();
+    connect(ConfigHandler::getInstance(), &ConfigHandler::fileChanged, this, &UploadNetwork::reloadConfig);
+
+    // Runs on the network thread just before it exits, so the manager and its
+    // connections are torn down where they were used.
+    connect(m_thread, &QThread::finished, this, &QObject::deleteLater, Qt::DirectConnection);
+
+    connect(qApp, &QCoreApplication::aboutToQuit, m_thread, [thread = m_thread]() {
+        thread->quit();
+        if (!thread->wait(3000)) {
+            AbstractLogger::warning() << "Upload network thread did not quit in time";
+        }
+    }, Qt::DirectConnection);
+
+    m_thread->start();
+}
+
+UploadNetwork* UploadNetwork::instance()
+{
+    static UploadNetwork* network = new UploadNetwork();
+    return network;
+}
+
+QNetworkAccessManager* UploadNetwork::networkAccessManager() const
+{
+    return m_NetworkAM;
+}
+
+bool UploadNetwork::isMultiplexed(const QString& host) const
+{
+    return m_multiplexed.contains(host.toLower());
+}
+
+void UploadNetwork::reloadConfig()
+{
+    ConfigHandler config;
+    m_http2 = config.uploadHttp2();
+
+    // Qt wants at least the protocol's default of 65535 bytes
+    quint32 session = quint32(config.uploadHttp2SessionWindow()) * 1024;
+    quint32 stream = qMin(quint32(config.uploadHttp2StreamWindow()) * 1024, session);
+    m_http2Config = QHttp2Configuration();
+    m_http2Config.setServerPushEnabled(false);
+    m_http2Config.setSessionReceiveWindowSize(session);
+    m_http2Config.setStreamReceiveWindowSize(stream);
+    if (!m_http2) {
+        m_multiplexed.clear();
+    }
+}
+
+void UploadNetwork::prepareRequest(QNetworkRequest& request) const
+{
+    // Requests that turned HTTP/2 off for themselves keep it off
+    if (request.attribute(QNetworkRequest::Http2AllowedAttribute, true).toBool()) {
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, m_http2);
+        request.setHttp2Configuration(m_http2Config);
+    }
+
+    if (request.url().scheme() == QLatin1String("https")) {
+        request.setSslConfiguration(
+          TlsSessionCache::instance()->configurationFor(request.url(), request.sslConfiguration()));
+    }
+}
+
+void UploadNetwork::watchReply(QNetworkReply* reply)
+{
+    // Only a reply that opened its connection goes through a handshake
+    auto handshake = std::make_shared<bool>(false);
+    connect(reply, &QNetworkReply::encrypted, this, [handshake]() {
+        *handshake = true;
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, handshake]() {
+        // TLS 1.3 tickets arrive after the handshake, they are in by now
+        if (reply->url().scheme() == QLatin1String("https")) {
+            TlsSessionCache::instance()->store(reply->url(), reply->sslConfiguration());
+        }
+        if (reply->request().url().scheme() == QLatin1String("https")) {
+            TlsSessionCache::instance()->release(reply->request().url(),
+                                                 reply->request().sslConfiguration(),
+                                                 *handshake);
+        }
+
+        // Only answered requests to an API node that could have used HTTP/2
+        // tell whether that node speaks it
+        QString host = reply->url().host().toLower();
+        bool answered = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid();
+        bool allowed = reply->request().attribute(QNetworkRequest::Http2AllowedAttribute).toBool();
+        if (answered && allowed && ApiEndpointPool::instance()->hasHost(host)) {
+            bool multiplexed = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+            if (multiplexed != m_multiplexed.contains(host)) {
+                AbstractLogger::info() << QStringLiteral("Uploads to %1 %2")
+                                            .arg(host,
+                                                 multiplexed ? QStringLiteral("share one HTTP/2 connection")
+                                                             : QStringLiteral("use HTTP/1.1"));
+            }
+            if (multiplexed) {
+                m_multiplexed.insert(host);
+            } else {
+                m_multiplexed.remove(host);
+            }
+        }
+    });
+}
+
+void UploadNetwork::prewarm()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        if (m_lastWarm.isValid() && m_lastWarm.elapsed() < PREWARM_MIN_INTERVAL_MS) {
+            return;
+        }
+        connectTo(QUrl(ApiEndpointPool::instance()->preferred()));
+    }, Qt::QueuedConnection);
+}
+
+void UploadNetwork::setKeepWarm(bool keepWarm)
+{
+    int intervalSecs = ConfigHandler().uploadKeepWarmInterval();
+    QMetaObject::invokeMethod(this, [this, keepWarm, intervalSecs]() {
+        if (keepWarm && intervalSecs > 0) {
+            m_keepWarmTimer->start(intervalSecs * 1000);
+        } else {
+            m_keepWarmTimer->stop();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void UploadNetwork::connectTo(const QUrl& endpoint)
+{
+    if (!endpoint.isValid() || endpoint.host().isEmpty()) {
+        return;
+    }
+    m_lastWarm.start();
+
+    if (endpoint.scheme() == QLatin1String("https")) {
+        // Offer HTTP/2 like a regular request does, otherwise the warm
+        // connection isn't the kind the upload looks for
+        QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+        if (m_http2) {
+            ssl.setAllowedNextProtocols({ QSslConfiguration::ALPNProtocolHTTP2,
+                                          QSslConfiguration::NextProtocolHttp1_1 });
+        } else {
+            ssl.setAllowedNextProtocols({ QSslConfiguration::NextProtocolHttp1_1 });
+        }
+        m_NetworkAM->connectToHostEncrypted(endpoint.host(), endpoint.port(443), ssl);
+    } else {
+        m_NetworkAM->connectToHost(endpoint.host(), endpoint.port(80));
+    }
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADNETWORK_H
+#define UPLOADNETWORK_H
+
+#include <QElapsedTimer>
+#include <QHttp2Configuration>
+#include <QObject>
+#include <QSet>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
+class QThread;
+class QTimer;
+class UploadAccessManager;
+
+/**
+ * @brief Owns the long-lived network thread and the one QNetworkAccessManager
+ * every upload shares.
+ *
+ * Sharing a single manager lets Qt reuse keep-alive connections between
+ * uploads instead of opening a new connection (and thread) per file. Objects
+ * that use `networkAccessManager()` must live on `thread()`.
+ *
+ * Requests may use HTTP/2 with the configured flow-control windows
+ * (`uploadHttp2*` options). Once an API node answers over HTTP/2 the
+ * uploads to it share one connection as multiplexed streams, and the
+ * scheduler lets `uploadHttp2MaxStreams` of them run at once instead of
+ * `uploadMaxConcurrent`. This is tracked per host, and only for API nodes:
+ * an S3 bucket or any other server says nothing about them.
+ *
+ * TLS sessions are resumed across processes through `TlsSessionCache`, so
+ * a one-shot CLI upload doesn't pay for a full handshake.
+ *
+ * `prewarm()` opens an encrypted connection to the API host ahead of an
+ * upload, so the upload skips lookup, TCP and TLS setup. With `keepWarm` the
+ * connection is renewed periodically while no upload is running.
+ */
+class UploadNetwork : public QObject
+{
+    Q_OBJECT
+
+public:
+    static UploadNetwork* instance();
+
+    QNetworkAccessManager* networkAccessManager() const;
+    // Whether the API node on `host` last answered over HTTP/2, network
+    // thread only
+    bool isMultiplexed(const QString& host) const;
+
+    // Both may be called from any thread
+    void prewarm();
+    void setKeepWarm(bool keepWarm);
+
+private:
+    explicit UploadNetwork();
+
+    friend class UploadAccessManager;
+
+    void reloadConfig();
+    void prepareRequest(QNetworkRequest& request) const;
+    void watchReply(QNetworkReply* reply);
+    void connectTo(const QUrl& endpoint);
+
+    QThread* m_thread;
+    QNetworkAccessManager* m_NetworkAM;
+    QTimer* m_keepWarmTimer;
+    QElapsedTimer m_lastWarm;
+    bool m_http2 = true;
+    QHttp2Configuration m_http2Config;
+    // API hosts that last answered over HTTP/2
+    QSet<QString> m_multiplexed;
+};
+
+#endif // UPLOADNETWORK_H
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADPRIORITY_H
+#define UPLOADPRIORITY_H
+
+/**
+ * @brief Traffic class of an upload. Interactive uploads are captures the
+ * user is waiting on; bulk is everything else (files, D-Bus, background).
+ */
+enum class UploadPriority
+{
+    Interactive,
+    Bulk,
+};
+
+#endif // UPLOADPRIORITY_H
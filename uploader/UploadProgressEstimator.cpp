@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadProgressEstimator.h"
+
+#include <cmath>
+
+UploadProgressEstimator::UploadProgressEstimator(int intervalMs, double timeConstantSecs)
+  : m_intervalMs(intervalMs)
+  , m_timeConstantSecs(timeConstantSecs)
+{
+    reset();
+}
+
+void UploadProgressEstimator::reset()
+{
+    m_clock.start();
+    m_lastSampleMs = 0;
+    m_lastSampleBytes = 0;
+    m_bytesSent = 0;
+    m_bytesTotal = 0;
+    m_rate = 0;
+    m_hasRate = false;
+    m_reportedAny = false;
+}
+
+bool UploadProgressEstimator::update(qint64 bytesSent, qint64 bytesTotal)
+{
+    if (bytesTotal <= 0) {
+        return false;
+    }
+    // A restarted transfer (retry, preemption) counts from its new position
+    if (bytesSent < m_lastSampleBytes) {
+        m_lastSampleBytes = bytesSent;
+    }
+    m_bytesSent = bytesSent;
+    m_bytesTotal = bytesTotal;
+
+    qint64 now = m_clock.elapsed();
+    qint64 elapsed = now - m_lastSampleMs;
+    bool done = bytesSent >= bytesTotal;
+    if (m_reportedAny && !done && elapsed < m_intervalMs) {
+        return false;
+    }
+
+    if (elapsed > 0) {
+        double sample = (bytesSent - m_lastSampleBytes) * 1000.0 / elapsed;
+        if (m_hasRate) {
+            // Weight by elapsed time, so irregular callbacks don't skew it
+            double alpha = 1.0 - std::exp(-(elapsed / 1000.0) / m_timeConstantSecs);
+            m_rate += alpha * (sample - m_rate);
+        } else if (m_reportedAny) {
+            m_rate = sample;
+            m_hasRate = true;
+        }
+    }
+
+    m_lastSampleMs = now;
+    m_lastSampleBytes = bytesSent;
+    m_reportedAny = true;
+    return true;
+}
+
+int UploadProgressEstimator::percent() const
+{
+    if (m_bytesTotal <= 0) {
+        return 0;
+    }
+    return int(qBound<qint64>(0, m_bytesSent * 100 / m_bytesTotal, 100));
+}
+
+double UploadProgressEstimator::bytesPerSecond() const
+{
+    return m_rate;
+}
+
+double UploadProgressEstimator::megabitsPerSecond() const
+{
+    return m_rate * 8.0 / 1'000'000;
+}
+
+int UploadProgressEstimator::etaSeconds() const
+{
+    if (!m_hasRate || m_rate <= 0) {
+        return -1;
+    }
+    qint64 remaining = qMax<qint64>(0, m_bytesTotal - m_bytesSent);
+    return int(std::ceil(remaining / m_rate));
+}
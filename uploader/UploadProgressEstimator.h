@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADPROGRESSESTIMATOR_H
+#define UPLOADPROGRESSESTIMATOR_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+/**
+ * @brief Turns raw byte-progress callbacks into a few stable updates per
+ * second.
+ *
+ * `update()` is cheap and may be called for every callback; it only asks for
+ * a report once per interval, when the percentage first becomes known, and at
+ * completion. Throughput is an exponentially weighted moving average over
+ * those reports, the ETA follows from it.
+ */
+class UploadProgressEstimator
+{
+public:
+    explicit UploadProgressEstimator(int intervalMs = 100, double timeConstantSecs = 2.0);
+
+    void reset();
+    // True if a progress report is due
+    bool update(qint64 bytesSent, qint64 bytesTotal);
+
+    int percent() const;
+    double bytesPerSecond() const;
+    double megabitsPerSecond() const;
+    // Seconds left at the current rate, -1 while unknown
+    int etaSeconds() const;
+
+private:
+    int m_intervalMs;
+    double m_timeConstantSecs;
+    QElapsedTimer m_clock;
+    qint64 m_lastSampleMs = 0;
+    qint64 m_lastSampleBytes = 0;
+    qint64 m_bytesSent = 0;
+    qint64 m_bytesTotal = 0;
+    double m_rate = 0;
+    bool m_hasRate = false;
+    bool m_reportedAny = false;
+};
+
+#endif // UPLOADPROGRESSESTIMATOR_H
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadRateLimiter.h"
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+#include <limits>
+
+#include "UploadNetwork.h"
+#include "../utils/ConfigHandler.h"
+#include "../utils/abstractlogger.h"
+
+// Burst allowance of a limited bucket, in seconds of its rate
+static constexpr double RATE_BURST_SECONDS = 0.25;
+static constexpr double RATE_MIN_BURST = 16 * 1024;
+// Bulk uploads stay paused this long after the last interactive read
+static constexpr qint64 RATE_INTERACTIVE_HOLD_MS = 500;
+// How often starved bodies are woken up
+static constexpr int RATE_WAKE_INTERVAL_MS = 20;
+
+void UploadRateLimiter::Bucket::configure(qint64 bytesPerSecond)
+{
+    rate = bytesPerSecond;
+    capacity = qMax(RATE_MIN_BURST, rate * RATE_BURST_SECONDS);
+    tokens = qMin(tokens, capacity);
+}
+
+void UploadRateLimiter::Bucket::refill(double seconds)
+{
+    if (rate > 0) {
+        tokens = qMin(capacity, tokens + rate * seconds);
+    }
+}
+
+qint64 UploadRateLimiter::Bucket::available() const
+{
+    return rate > 0 ? qint64(tokens) : std::numeric_limits<qint64>::max();
+}
+
+UploadRateLimiter::UploadRateLimiter()
+  : QObject(nullptr)
+  , m_wakeTimer(new QTimer(this))
+{
+    moveToThread(UploadNetwork::instance()->thread());
+
+    m_clock.start();
+    m_wakeTimer->setInterval(RATE_WAKE_INTERVAL_MS);
+    connect(m_wakeTimer, &QTimer::timeout, this, &UploadRateLimiter::wake);
+
+    reloadConfig();
+    // Apply limit changes without restarting
+    connect(ConfigHandler::getInstance(), &ConfigHandler::fileChanged, this, &UploadRateLimiter::reloadConfig);
+}
+
+UploadRateLimiter* UploadRateLimiter::instance()
+{
+    static UploadRateLimiter* limiter = new UploadRateLimiter();
+    return limiter;
+}
+
+void UploadRateLimiter::reloadConfig()
+{
+    ConfigHandler config;
+    qint64 global = qint64(config.uploadRateLimit()) * 1024;
+    qint64 bulk = qint64(config.uploadBulkRateLimit()) * 1024;
+
+    QMutexLocker locker(&m_mutex);
+    if (global == m_global.rate && bulk == m_bulk.rate) {
+        return;
+    }
+    refill();
+    m_global.configure(global);
+    m_bulk.configure(bulk);
+    AbstractLogger::info() << QStringLiteral("Upload rate limit: %1 KiB/s, bulk %2 KiB/s (0 = unlimited)")
+                                .arg(global / 1024)
+                                .arg(bulk / 1024);
+}
+
+void UploadRateLimiter::refill()
+{
+    qint64 now = m_clock.nsecsElapsed();
+    double seconds = (now - m_lastRefillNs) / 1e9;
+    m_lastRefillNs = now;
+    m_global.refill(seconds);
+    m_bulk.refill(seconds);
+}
+
+qint64 UploadRateLimiter::acquire(UploadPriority priority, qint64 wanted)
+{
+    QMutexLocker locker(&m_mutex);
+
+    qint64 granted = wanted;
+    if (priority == UploadPriority::Interactive) {
+        m_lastInteractive.start();
+    } else if (m_lastInteractive.isValid() &&
+               m_lastInteractive.elapsed() < RATE_INTERACTIVE_HOLD_MS) {
+        granted = 0;
+    }
+
+    if (granted > 0 && (m_global.rate > 0 || m_bulk.rate > 0)) {
+        refill();
+        granted = qMin(granted, m_global.available());
+        if (priority == UploadPriority::Bulk) {
+            granted = qMin(granted, m_bulk.available());
+        }
+        if (m_global.rate > 0) {
+            m_global.tokens -= granted;
+        }
+        if (priority == UploadPriority::Bulk && m_bulk.rate > 0) {
+            m_bulk.tokens -= granted;
+        }
+    }
+
+    if (granted < wanted && !m_starved) {
+        m_starved = true;
+        // The timer belongs to the network thread
+        QMetaObject::invokeMethod(m_wakeTimer, qOverload<>(&QTimer::start), Qt::AutoConnection);
+    }
+    return granted;
+}
+
+void UploadRateLimiter::refund(UploadPriority priority, qint64 bytes)
+{
+    if (bytes <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_global.rate > 0) {
+        m_global.tokens = qMin(m_global.capacity, m_global.tokens + bytes);
+    }
+    if (priority == UploadPriority::Bulk && m_bulk.rate > 0) {
+        m_bulk.tokens = qMin(m_bulk.capacity, m_bulk.tokens + bytes);
+    }
+}
+
+void UploadRateLimiter::wake()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_starved) {
+            m_wakeTimer->stop();
+            return;
+        }
+        // Bodies that are still short set it again from acquire()
+        m_starved = false;
+    }
+    emit tokensAvailable();
+}
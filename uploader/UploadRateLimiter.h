@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADRATELIMITER_H
+#define UPLOADRATELIMITER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+
+#include "UploadPriority.h"
+
+class QTimer;
+
+/**
+ * @brief Global token bucket for upload bandwidth, shared by every request
+ * body.
+ *
+ * All traffic draws from the `uploadRateLimit` bucket, bulk traffic also from
+ * its own `uploadBulkRateLimit` bucket. Bulk uploads pause while an
+ * interactive upload is sending, so a capture never waits behind a folder
+ * upload. The limits are re-read whenever the config file changes.
+ *
+ * Bodies that get no tokens return a short read and wait for
+ * `tokensAvailable()` before signalling `readyRead()` again.
+ */
+class UploadRateLimiter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static UploadRateLimiter* instance();
+
+    /**
+     * @brief Take up to `wanted` bytes worth of tokens.
+     * @return The number of bytes that may be sent now, possibly 0.
+     */
+    qint64 acquire(UploadPriority priority, qint64 wanted);
+    // Return tokens that were acquired but not sent
+    void refund(UploadPriority priority, qint64 bytes);
+
+signals:
+    void tokensAvailable();
+
+private:
+    explicit UploadRateLimiter();
+
+    struct Bucket
+    {
+        qint64 rate = 0; // bytes per second, 0 = unlimited
+        double tokens = 0;
+        double capacity = 0;
+
+        void configure(qint64 bytesPerSecond);
+        void refill(double seconds);
+        qint64 available() const;
+    };
+
+    void reloadConfig();
+    void refill();
+    void wake();
+
+    QMutex m_mutex;
+    Bucket m_global;
+    Bucket m_bulk;
+    QElapsedTimer m_clock;
+    qint64 m_lastRefillNs = 0;
+    QElapsedTimer m_lastInteractive;
+    bool m_starved = false;
+    QTimer* m_wakeTimer;
+};
+
+#endif // UPLOADRATELIMITER_H
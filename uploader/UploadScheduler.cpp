@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadScheduler.h"
+
+#include "UploadNetwork.h"
+#include "../utils/ConfigHandler.h"
+#include "../utils/abstractlogger.h"
+
+UploadScheduler::UploadScheduler()
+  : QObject(nullptr)
+  , m_policy(UploadSchedulingPolicy::create(ConfigHandler().uploadSchedulingPolicy()))
+{
+    m_clock.start();
+    moveToThread(UploadNetwork::instance()->thread());
+}
+
+UploadScheduler* UploadScheduler::instance()
+{
+    static UploadScheduler* scheduler = new UploadScheduler();
+    return scheduler;
+}
+
+int UploadScheduler::runningCount() const
+{
+    return m_running.size();
+}
+
+int UploadScheduler::pendingCount() const
+{
+    return m_pending.size();
+}
+
+void UploadScheduler::enqueue(UploadJob job)
+{
+    // Read on the caller's thread, the config is owned by the GUI thread
+    ConfigHandler config;
+    int maxConcurrent = config.uploadMaxConcurrent();
+    int maxStreams = config.uploadHttp2MaxStreams();
+    QString policyName = config.uploadSchedulingPolicy();
+
+    QObject* worker = job.worker.data();
+    connect(worker, &QObject::destroyed, this, [this, worker]() {
+        release(worker);
+    });
+
+    QMetaObject::invokeMethod(this, [this, job = std::move(job), maxConcurrent, maxStreams, policyName]() mutable {
+        m_maxConcurrent = qMax(1, maxConcurrent);
+        m_maxStreams = qMax(m_maxConcurrent, maxStreams);
+        if (policyName != m_policy->name()) {
+            m_policy = UploadSchedulingPolicy::create(policyName);
+        }
+
+        job.enqueuedAt = m_clock.elapsed();
+        m_pending.append(job);
+        if (m_running.size() >= limitFor(job)) {
+            preemptFor(job);
+        }
+        dispatch();
+    }, Qt::QueuedConnection);
+}
+
+void UploadScheduler::release(QObject* worker)
+{
+    // From `destroyed` the QPointer already reads null, a deleted worker
+    // is matched by that
+    qsizetype removed = m_running.removeIf([worker](const UploadJob& job) {
+        return job.worker.isNull() || job.worker == worker;
+    });
+    if (removed > 0) {
+        dispatch();
+    }
+}
+
+/**
+ * @brief Free a slot for `job` if the policy finds a running upload that
+ * should make way for it.
+ */
+void UploadScheduler::preemptFor(const UploadJob& job)
+{
+    int index = m_policy->preemptFor(job, m_running);
+    if (index < 0) {
+        return;
+    }
+
+    UploadJob victim = m_running.takeAt(index);
+    if (victim.worker.isNull()) {
+        return;
+    }
+    ++victim.preemptions;
+    // Aging starts over, otherwise its wait would win the slot straight back
+    victim.enqueuedAt = m_clock.elapsed();
+    AbstractLogger::info() << QStringLiteral("Suspending a %1 byte upload for an interactive one")
+                                .arg(victim.size);
+    victim.suspend();
+    m_pending.append(victim);
+}
+
+// How many uploads may be running for `job` to start
+int UploadScheduler::limitFor(const UploadJob& job) const
+{
+    // Streams on one HTTP/2 connection are cheaper than connections
+    if (!job.host.isEmpty() && UploadNetwork::instance()->isMultiplexed(job.host)) {
+        return m_maxStreams;
+    }
+    return m_maxConcurrent;
+}
+
+void UploadScheduler::dispatch()
+{
+    while (!m_pending.isEmpty()) {
+        int index = m_policy->next(m_pending, m_clock.elapsed());
+        // The owner may have been cancelled and deleted while queued
+        if (m_pending[index].worker.isNull()) {
+            m_pending.removeAt(index);
+            continue;
+        }
+        // The policy's pick waits for a slot, nothing jumps the queue
+        if (m_running.size() >= limitFor(m_pending[index])) {
+            break;
+        }
+        UploadJob next = m_pending.takeAt(index);
+        m_running.append(next);
+        next.start();
+    }
+
+    if (!m_pending.isEmpty()) {
+        AbstractLogger::info() << QStringLiteral("Upload queued, %1 running, %2 waiting")
+                                    .arg(m_running.size())
+                                    .arg(m_pending.size());
+    }
+}
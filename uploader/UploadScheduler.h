@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADSCHEDULER_H
+#define UPLOADSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QUrl>
+#include <functional>
+#include <memory>
+
+#include "UploadPriority.h"
+#include "UploadSchedulingPolicy.h"
+
+/**
+ * @brief Caps the number of uploads in flight and queues the rest.
+ *
+ * Lives on the `UploadNetwork` thread. `submit()` may be called from any
+ * thread; the start function is always run on the network thread once a slot
+ * is free. A job holds its slot until its worker emits `uploadFinished()` or
+ * is destroyed.
+ *
+ * At most `uploadMaxConcurrent` uploads run at once. A job whose target
+ * host is an API node that speaks HTTP/2 may start while fewer than
+ * `uploadHttp2MaxStreams` are running, since it only adds a stream.
+ *
+ * The order of queued jobs, and whether an interactive job may suspend a
+ * running one, is up to the `uploadSchedulingPolicy` config option. A
+ * suspended job goes back in the queue and is started again from scratch
+ * (resumable uploads pick up their session).
+ */
+class UploadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static UploadScheduler* instance();
+
+    template<typename Worker>
+    void submit(Worker* worker,
+                std::function<void()> start,
+                UploadPriority priority = UploadPriority::Bulk,
+                qint64 size = -1,
+                const QUrl& target = {})
+    {
+        connect(worker, &Worker::uploadFinished, this, [this, worker]() {
+            release(worker);
+        });
+
+        UploadJob job;
+        job.worker = worker;
+        job.start = std::move(start);
+        job.suspend = [worker]() {
+            worker->cancelUpload();
+        };
+        job.priority = priority;
+        job.size = size;
+        job.host = target.host().toLower();
+        enqueue(std::move(job));
+    }
+
+    int runningCount() const;
+    int pendingCount() const;
+
+private:
+    explicit UploadScheduler();
+
+    void enqueue(UploadJob job);
+    void release(QObject* worker);
+    void preemptFor(const UploadJob& job);
+    void dispatch();
+    int limitFor(const UploadJob& job) const;
+
+    std::unique_ptr<UploadSchedulingPolicy> m_policy;
+    QList<UploadJob> m_pending;
+    QList<UploadJob> m_running;
+    QElapsedTimer m_clock;
+    int m_maxConcurrent = 1;
+    int m_maxStreams = 1;
+};
+
+#endif // UPLOADSCHEDULER_H
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadSchedulingPolicy.h"
+
+// Nominal upload rate used to turn a size into an expected time
+static constexpr double SEJF_NOMINAL_BYTES_PER_SEC = 4.0 * 1024 * 1024;
+// Assumed size of a job whose size isn't known
+static constexpr qint64 SEJF_UNKNOWN_SIZE = 8 * 1024 * 1024;
+// Interactive jobs count as this fraction of their expected time
+static constexpr double SEJF_INTERACTIVE_WEIGHT = 0.1;
+// Seconds of expected time forgiven per second spent waiting
+static constexpr double SEJF_AGING_RATE = 1.0;
+// Only transfers at least this large are worth suspending
+static constexpr qint64 SEJF_PREEMPT_MIN_SIZE = 16 * 1024 * 1024;
+// A job is not suspended more often than this
+static constexpr int SEJF_MAX_PREEMPTIONS = 2;
+
+int UploadSchedulingPolicy::preemptFor(const UploadJob& incoming, const QList<UploadJob>& running) const
+{
+    Q_UNUSED(incoming)
+    Q_UNUSED(running)
+    return -1;
+}
+
+std::unique_ptr<UploadSchedulingPolicy> UploadSchedulingPolicy::create(const QString& name)
+{
+    if (name.compare(QLatin1String("fifo"), Qt::CaseInsensitive) == 0) {
+        return std::make_unique<FifoSchedulingPolicy>();
+    }
+    return std::make_unique<ShortestJobFirstPolicy>();
+}
+
+// FIFO
+
+QString FifoSchedulingPolicy::name() const
+{
+    return QStringLiteral("fifo");
+}
+
+int FifoSchedulingPolicy::next(const QList<UploadJob>& pending, qint64 now) const
+{
+    Q_UNUSED(now)
+    for (int i = 0; i < pending.size(); ++i) {
+        if (pending.at(i).priority == UploadPriority::Interactive) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// SHORTEST EXPECTED JOB FIRST
+
+QString ShortestJobFirstPolicy::name() const
+{
+    return QStringLiteral("sejf");
+}
+
+double ShortestJobFirstPolicy::score(const UploadJob& job, qint64 now)
+{
+    qint64 size = job.size >= 0 ? job.size : SEJF_UNKNOWN_SIZE;
+    double expected = size / SEJF_NOMINAL_BYTES_PER_SEC;
+    if (job.priority == UploadPriority::Interactive) {
+        expected *= SEJF_INTERACTIVE_WEIGHT;
+    }
+    double waited = (now - job.enqueuedAt) / 1000.0;
+    return expected - SEJF_AGING_RATE * waited;
+}
+
+int ShortestJobFirstPolicy::next(const QList<UploadJob>& pending, qint64 now) const
+{
+    // Ties keep arrival order
+    int best = 0;
+    double bestScore = score(pending.first(), now);
+    for (int i = 1; i < pending.size(); ++i) {
+        double candidate = score(pending.at(i), now);
+        if (candidate < bestScore) {
+            best = i;
+            bestScore = candidate;
+        }
+    }
+    return best;
+}
+
+int ShortestJobFirstPolicy::preemptFor(const UploadJob& incoming, const QList<UploadJob>& running) const
+{
+    if (incoming.priority != UploadPriority::Interactive) {
+        return -1;
+    }
+
+    int victim = -1;
+    for (int i = 0; i < running.size(); ++i) {
+        const UploadJob& job = running.at(i);
+        if (job.priority != UploadPriority::Bulk || !job.suspend ||
+            job.size < SEJF_PREEMPT_MIN_SIZE || job.preemptions >= SEJF_MAX_PREEMPTIONS) {
+            continue;
+        }
+        if (victim < 0 || job.size > running.at(victim).size) {
+            victim = i;
+        }
+    }
+    return victim;
+}
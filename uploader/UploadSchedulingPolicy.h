@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADSCHEDULINGPOLICY_H
+#define UPLOADSCHEDULINGPOLICY_H
+
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <functional>
+#include <memory>
+
+#include "UploadPriority.h"
+
+/// An upload as the scheduler sees it.
+struct UploadJob
+{
+    QPointer<QObject> worker;
+    std::function<void()> start;
+    // Stops the transfer without reporting it finished; null if the job
+    // can't be preempted
+    std::function<void()> suspend;
+    UploadPriority priority = UploadPriority::Bulk;
+    qint64 size = -1; // bytes, -1 if unknown
+    QString host; // the server it goes to, empty if unknown
+    qint64 enqueuedAt = 0; // ms on the scheduler clock
+    int preemptions = 0;
+};
+
+/**
+ * @brief Decides which queued upload starts next, and which running one
+ * makes room for an interactive upload when every slot is taken.
+ */
+class UploadSchedulingPolicy
+{
+public:
+    virtual ~UploadSchedulingPolicy() = default;
+
+    virtual QString name() const = 0;
+    // Index into `pending` of the job to start next, `pending` is not empty
+    virtual int next(const QList<UploadJob>& pending, qint64 now) const = 0;
+    // Index into `running` of the job to suspend for `incoming`, or -1
+    virtual int preemptFor(const UploadJob& incoming, const QList<UploadJob>& running) const;
+
+    /**
+     * @brief Create a policy by config name: "fifo" or "sejf". Unknown names
+     * fall back to "sejf".
+     */
+    static std::unique_ptr<UploadSchedulingPolicy> create(const QString& name);
+};
+
+/// Arrival order, interactive jobs ahead of bulk ones. Never preempts.
+class FifoSchedulingPolicy : public UploadSchedulingPolicy
+{
+public:
+    QString name() const override;
+    int next(const QList<UploadJob>& pending, qint64 now) const override;
+};
+
+/**
+ * @brief Shortest expected job first, to minimise the mean time to URL.
+ *
+ * A job's expected time is its size at a nominal rate, scaled down for
+ * interactive jobs. Waiting earns credit against it (aging), so a large file
+ * still starts eventually under a steady stream of small ones. An incoming
+ * interactive job may suspend the largest running bulk transfer.
+ */
+class ShortestJobFirstPolicy : public UploadSchedulingPolicy
+{
+public:
+    QString name() const override;
+    int next(const QList<UploadJob>& pending, qint64 now) const override;
+    int preemptFor(const UploadJob& incoming, const QList<UploadJob>& running) const override;
+
+private:
+    static double score(const UploadJob& job, qint64 now);
+};
+
+#endif // UPLOADSCHEDULINGPOLICY_H
@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadSource.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+
+#include "../utils/abstractlogger.h"
+
+#if defined(Q_OS_UNIX)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Pages behind the read position are released in batches of this size
+static constexpr qint64 MAPPED_RELEASE_WINDOW = 8 * 1024 * 1024;
+
+// BYTE ARRAY
+
+ByteArraySource::ByteArraySource(QByteArray data)
+  : m_data(std::move(data))
+{}
+
+qint64 ByteArraySource::size() const
+{
+    return m_data.size();
+}
+
+qint64 ByteArraySource::readAt(qint64 offset, char* data, qint64 maxSize)
+{
+    if (offset < 0 || offset > m_data.size()) {
+        return -1;
+    }
+    qint64 count = qMin(maxSize, m_data.size() - offset);
+    std::memcpy(data, m_data.constData() + offset, count);
+    return count;
+}
+
+const char* ByteArraySource::constData() const
+{
+    return m_data.constData();
+}
+
+// FILE REGION
+
+FileRegionSource::FileRegionSource(const QString& filePath, qint64 offset, qint64 length)
+  : m_file(filePath)
+  , m_offset(offset)
+  , m_length(length)
+{}
+
+bool FileRegionSource::open()
+{
+    // Unbuffered: reads land directly in the network buffer
+    if (!m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return false;
+    }
+    qint64 available = qMax<qint64>(0, m_file.size() - m_offset);
+    m_length = m_length < 0 ? available : qMin(m_length, available);
+    return true;
+}
+
+qint64 FileRegionSource::size() const
+{
+    return qMax<qint64>(0, m_length);
+}
+
+qint64 FileRegionSource::readAt(qint64 offset, char* data, qint64 maxSize)
+{
+    if (!m_file.isOpen() || offset < 0 || offset > m_length) {
+        return -1;
+    }
+    if (m_file.pos() != m_offset + offset && !m_file.seek(m_offset + offset)) {
+        return -1;
+    }
+    return m_file.read(data, qMin(maxSize, m_length - offset));
+}
+
+QString FileRegionSource::errorString() const
+{
+    return m_file.errorString();
+}
+
+// MAPPED FILE
+
+MappedFileSource::MappedFileSource(const QString& filePath)
+  : m_file(filePath)
+{}
+
+MappedFileSource::~MappedFileSource()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+bool MappedFileSource::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size == 0) {
+        return true;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        return false;
+    }
+
+#if defined(Q_OS_UNIX)
+    madvise(m_data, static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+    posix_fadvise(m_file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+qint64 MappedFileSource::size() const
+{
+    return m_size;
+}
+
+qint64 MappedFileSource::readAt(qint64 offset, char* data, qint64 maxSize)
+{
+    if (offset < 0 || offset > m_size) {
+        return -1;
+    }
+    qint64 count = qMin(maxSize, m_size - offset);
+    if (m_truncated) {
+        return -1;
+    }
+    if (count > 0) {
+        // Copied with a read, not out of the mapping: a file truncated
+        // meanwhile, e.g. a rotated log, then reads short instead of faulting
+        qint64 copied = 0;
+#if defined(Q_OS_UNIX)
+        while (copied < count) {
+            ssize_t n = ::pread(m_file.handle(), data + copied, size_t(count - copied), off_t(offset + copied));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            copied += n;
+        }
+#else
+        if (m_file.seek(offset)) {
+            copied = qMax<qint64>(m_file.read(data, count), 0);
+        }
+#endif
+        if (copied < count) {
+            AbstractLogger::warning() << QStringLiteral("%1 shrank during the upload").arg(m_file.fileName());
+            m_truncated = true;
+            return -1;
+        }
+    }
+    if (m_releaseBehind) {
+        releaseBefore(offset + count);
+    }
+    return count;
+}
+
+QString MappedFileSource::errorString() const
+{
+    return m_truncated ? QStringLiteral("the file shrank during the upload") : m_file.errorString();
+}
+
+void MappedFileSource::setReleaseBehind(bool releaseBehind)
+{
+    m_releaseBehind = releaseBehind;
+}
+
+/**
+ * @brief Drop the pages that were already read from the resident set and the
+ * page cache. They fault back in from the file if the body is rewound.
+ */
+void MappedFileSource::releaseBefore(qint64 offset)
+{
+#if defined(Q_OS_UNIX)
+    static const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    qint64 end = offset - (offset % pageSize);
+
+    // Rewound (redirect or retry), start counting from the new position
+    if (end < m_releasedUntil) {
+        m_releasedUntil = end;
+        return;
+    }
+    if (end - m_releasedUntil < MAPPED_RELEASE_WINDOW && offset < m_size) {
+        return;
+    }
+
+    qint64 length = end - m_releasedUntil;
+    if (length > 0) {
+        madvise(m_data + m_releasedUntil, static_cast<size_t>(length), MADV_DONTNEED);
+        posix_fadvise(m_file.handle(), m_releasedUntil, length, POSIX_FADV_DONTNEED);
+        m_releasedUntil = end;
+    }
+#else
+    Q_UNUSED(offset)
+#endif
+}
+
+// HASHING
+
+HashingSource::HashingSource(QSharedPointer<UploadSource> inner, QCryptographicHash::Algorithm algorithm)
+  : m_inner(std::move(inner))
+  , m_hash(algorithm)
+{}
+
+qint64 HashingSource::size() const
+{
+    return m_inner->size();
+}
+
+qint64 HashingSource::readAt(qint64 offset, char* data, qint64 maxSize)
+{
+    qint64 read = m_inner->readAt(offset, data, maxSize);
+    // Only extend the digest in order; rewinds re-read bytes already hashed
+    if (read > 0 && offset <= m_hashedUntil && offset + read > m_hashedUntil) {
+        qint64 skip = m_hashedUntil - offset;
+        m_hash.addData(QByteArrayView(data + skip, read - skip));
+        m_hashedUntil = offset + read;
+    }
+    return read;
+}
+
+QString HashingSource::errorString() const
+{
+    return m_inner->errorString();
+}
+
+const char* HashingSource::constData() const
+{
+    return m_inner->constData();
+}
+
+void HashingSource::setReleaseBehind(bool releaseBehind)
+{
+    m_inner->setReleaseBehind(releaseBehind);
+}
+
+QByteArray HashingSource::result() const
+{
+    if (m_hashedUntil != m_inner->size()) {
+        return {};
+    }
+    return m_hash.result();
+}
+
+// FAN-OUT
+
+namespace {
+
+struct FanOutGroup
+{
+    QMutex mutex;
+    QSharedPointer<UploadSource> source;
+    MappedFileSource* mapped = nullptr;
+    // Read position of each reader
+    QList<qint64> positions;
+};
+
+class FanOutReader : public UploadSource
+{
+public:
+    FanOutReader(QSharedPointer<FanOutGroup> group, int index)
+      : m_group(std::move(group))
+      , m_index(index)
+    {}
+
+    ~FanOutReader() override
+    {
+        // A reader that is gone no longer holds pages back
+        QMutexLocker locker(&m_group->mutex);
+        advance(m_group->source->size());
+    }
+
+    qint64 size() const override { return m_group->source->size(); }
+
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override
+    {
+        // FileRegionSource seeks a shared handle, reads can't overlap
+        QMutexLocker locker(&m_group->mutex);
+        qint64 read = m_group->source->readAt(offset, data, maxSize);
+        if (read >= 0) {
+            advance(offset + read);
+        }
+        return read;
+    }
+
+    QString errorString() const override { return m_group->source->errorString(); }
+    const char* constData() const override { return m_group->source->constData(); }
+
+private:
+    void advance(qint64 position)
+    {
+        m_group->positions[m_index] = position;
+        if (m_group->mapped) {
+            m_group->mapped->releaseBefore(
+              *std::min_element(m_group->positions.cbegin(), m_group->positions.cend()));
+        }
+    }
+
+    QSharedPointer<FanOutGroup> m_group;
+    int m_index;
+};
+
+} // namespace
+
+QList<QSharedPointer<UploadSource>> fanOutSource(const QSharedPointer<UploadSource>& source, int readers)
+{
+    auto group = QSharedPointer<FanOutGroup>::create();
+    group->source = source;
+    group->positions.fill(0, readers);
+    group->mapped = dynamic_cast<MappedFileSource*>(source.data());
+    if (group->mapped) {
+        group->mapped->setReleaseBehind(false);
+    }
+
+    QList<QSharedPointer<UploadSource>> result;
+    for (int i = 0; i < readers; ++i) {
+        result.append(QSharedPointer<UploadSource>(new FanOutReader(group, i)));
+    }
+    return result;
+}
+
+QByteArray fileFingerprint(const QString& filePath)
+{
+    QFileInfo info(filePath);
+    QByteArray identity = info.absoluteFilePath().toUtf8() + '\n' +
+                          QByteArray::number(info.size()) + '\n' +
+                          QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    return QCryptographicHash::hash(identity, QCryptographicHash::Sha1);
+}
+
+QSharedPointer<UploadSource> openFileSource(const QString& filePath)
+{
+    QSharedPointer<UploadSource> mapped(new MappedFileSource(filePath));
+    if (mapped->open()) {
+        return mapped;
+    }
+    AbstractLogger::warning() << QStringLiteral("Could not map %1, falling back to buffered reads").arg(filePath);
+
+    QSharedPointer<UploadSource> region(new FileRegionSource(filePath));
+    if (region->open()) {
+        return region;
+    }
+    return {};
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADSOURCE_H
+#define UPLOADSOURCE_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+/**
+ * @brief Random-access payload for an upload body.
+ *
+ * Sources are shared between devices through QSharedPointer, so one payload
+ * can back several request bodies without being copied.
+ */
+class UploadSource
+{
+public:
+    virtual ~UploadSource() = default;
+
+    virtual bool open() { return true; }
+    virtual qint64 size() const = 0;
+    /**
+     * @brief Copy up to `maxSize` bytes starting at `offset` into `data`.
+     * @return Number of bytes copied, or -1 on error.
+     */
+    virtual qint64 readAt(qint64 offset, char* data, qint64 maxSize) = 0;
+    virtual QString errorString() const { return {}; }
+    /// The whole payload if it is contiguous in memory, otherwise null
+    virtual const char* constData() const { return nullptr; }
+    /**
+     * @brief Whether the pages behind a read may be dropped as the upload
+     * moves on. Turned off by readers that have several ranges in flight.
+     */
+    virtual void setReleaseBehind(bool releaseBehind) { Q_UNUSED(releaseBehind) }
+};
+
+/// Serves an in-memory payload. The QByteArray is implicitly shared, never copied.
+class ByteArraySource : public UploadSource
+{
+public:
+    explicit ByteArraySource(QByteArray data);
+
+    qint64 size() const override;
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override;
+    const char* constData() const override;
+
+private:
+    QByteArray m_data;
+};
+
+/// Serves `length` bytes of a file starting at `offset` (-1 reads to the end).
+class FileRegionSource : public UploadSource
+{
+public:
+    explicit FileRegionSource(const QString& filePath, qint64 offset = 0, qint64 length = -1);
+
+    bool open() override;
+    qint64 size() const override;
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override;
+    QString errorString() const override;
+
+private:
+    QFile m_file;
+    qint64 m_offset;
+    qint64 m_length;
+};
+
+/**
+ * @brief Serves a whole file through a read-only memory mapping.
+ *
+ * The mapping is advised for sequential access and pages behind the read
+ * position are handed back to the kernel as the upload progresses, so the
+ * resident set stays small no matter how large the file is.
+ *
+ * Touching a mapping past the end of a file that shrank faults with SIGBUS,
+ * so reads copy with `pread()` and never through the mapping. The mapping is
+ * kept for the access hints, and a shrunk file fails the read like a short
+ * read would. There is no constData() for the same reason.
+ */
+class MappedFileSource : public UploadSource
+{
+public:
+    explicit MappedFileSource(const QString& filePath);
+    ~MappedFileSource() override;
+
+    bool open() override;
+    qint64 size() const override;
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override;
+    QString errorString() const override;
+
+    // Off when several readers share the mapping or ranges are read out of
+    // order, a read would drop pages another one is still sending
+    void setReleaseBehind(bool releaseBehind) override;
+    void releaseBefore(qint64 offset);
+
+private:
+    QFile m_file;
+    uchar* m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_releasedUntil = 0;
+    bool m_releaseBehind = true;
+    bool m_truncated = false;
+};
+
+/**
+ * @brief Hashes another source as the upload reads it, so the content hash
+ * comes for free with the upload instead of costing a second read.
+ */
+class HashingSource : public UploadSource
+{
+public:
+    HashingSource(QSharedPointer<UploadSource> inner, QCryptographicHash::Algorithm algorithm);
+
+    qint64 size() const override;
+    qint64 readAt(qint64 offset, char* data, qint64 maxSize) override;
+    QString errorString() const override;
+    const char* constData() const override;
+    void setReleaseBehind(bool releaseBehind) override;
+
+    /// The digest, or empty if the payload wasn't read through in order
+    QByteArray result() const;
+
+private:
+    QSharedPointer<UploadSource> m_inner;
+    QCryptographicHash m_hash;
+    qint64 m_hashedUntil = 0;
+};
+
+/**
+ * @brief Identify one version of a file by path, size and modification time.
+ */
+QByteArray fileFingerprint(const QString& filePath);
+
+/**
+ * @brief Give several uploads their own reader of one source, so a payload
+ * that goes to several destinations is opened and read into memory once.
+ *
+ * A memory-mapped file releases its pages only once every reader has passed
+ * them (or was destroyed). Readers may be used from different threads.
+ */
+QList<QSharedPointer<UploadSource>> fanOutSource(const QSharedPointer<UploadSource>& source, int readers);
+
+/**
+ * @brief Open the best available source for a file: a memory mapping where
+ * supported, otherwise plain reads.
+ * @return The opened source, or null if the file can't be read.
+ */
+QSharedPointer<UploadSource> openFileSource(const QString& filePath);
+
+#endif // UPLOADSOURCE_H
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "UploadTimings.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QUrl>
+
+// Timings kept in memory per endpoint
+static constexpr int TIMINGS_RECENT_PER_ENDPOINT = 500;
+// The log file is rotated once it grows past this
+static constexpr qint64 TIMINGS_LOG_MAX_SIZE = 4 * 1024 * 1024;
+
+static QString endpointOf(const QUrl& url)
+{
+    return url.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment |
+                        QUrl::RemoveUserInfo)
+      .toString();
+}
+
+qint64 UploadTimings::connectMs() const
+{
+    if (connectStart < 0) {
+        return connectionReused ? 0 : -1;
+    }
+    qint64 connected = encrypted >= 0 ? encrypted : -1;
+    return connected >= 0 ? connected - connectStart : -1;
+}
+
+qint64 UploadTimings::uploadMs() const
+{
+    if (requestSent < 0) {
+        return -1;
+    }
+    qint64 start = encrypted >= 0 ? encrypted : (connectStart >= 0 ? connectStart : 0);
+    return requestSent - start;
+}
+
+qint64 UploadTimings::serverMs() const
+{
+    if (requestSent < 0 || firstByte < 0) {
+        return -1;
+    }
+    return firstByte - requestSent;
+}
+
+QString UploadTimings::summary() const
+{
+    auto ms = [](qint64 value) {
+        return value >= 0 ? QStringLiteral("%1 ms").arg(value) : QStringLiteral("?");
+    };
+    return QStringLiteral(
+             "%1: connect %2, upload %3, server %4, first byte %5, total %6, time to URL %7 (%8%9)")
+      .arg(endpoint,
+           connectionReused ? QStringLiteral("reused") : ms(connectMs()),
+           ms(uploadMs()),
+           ms(serverMs()),
+           ms(firstByte),
+           ms(finished),
+           ms(timeToUrl),
+           http2 ? QStringLiteral("HTTP/2") : QStringLiteral("HTTP/1.1"),
+           bytes > 0 ? QStringLiteral(", %1 bytes").arg(bytes) : QString());
+}
+
+QJsonObject UploadTimings::toJson() const
+{
+    return { { QStringLiteral("endpoint"), endpoint },
+             { QStringLiteral("startedAt"), startedAt },
+             { QStringLiteral("bytes"), bytes },
+             { QStringLiteral("reused"), connectionReused },
+             { QStringLiteral("http2"), http2 },
+             { QStringLiteral("connectStart"), connectStart },
+             { QStringLiteral("encrypted"), encrypted },
+             { QStringLiteral("requestSent"), requestSent },
+             { QStringLiteral("firstByte"), firstByte },
+             { QStringLiteral("finished"), finished },
+             { QStringLiteral("timeToUrl"), timeToUrl } };
+}
+
+QSharedPointer<UploadTimings> UploadTimings::track(QNetworkReply* reply)
+{
+    auto timings = QSharedPointer<UploadTimings>::create();
+    timings->endpoint = endpointOf(reply->url());
+    timings->startedAt = QDateTime::currentMSecsSinceEpoch();
+
+    auto clock = QSharedPointer<QElapsedTimer>::create();
+    clock->start();
+
+    QObject::connect(reply, &QNetworkReply::socketStartedConnecting, reply, [timings, clock]() {
+        timings->connectionReused = false;
+        timings->connectStart = clock->elapsed();
+    });
+    QObject::connect(reply, &QNetworkReply::encrypted, reply, [timings, clock]() {
+        timings->encrypted = clock->elapsed();
+    });
+    // Repeated on redirects and retries, the last one counts
+    QObject::connect(reply, &QNetworkReply::requestSent, reply, [timings, clock]() {
+        timings->requestSent = clock->elapsed();
+    });
+    QObject::connect(reply, &QNetworkReply::uploadProgress, reply, [timings](qint64 sent, qint64) {
+        timings->bytes = sent;
+    });
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, reply, [timings, clock]() {
+        if (timings->firstByte < 0) {
+            timings->firstByte = clock->elapsed();
+        }
+    });
+    QObject::connect(reply, &QNetworkReply::finished, reply, [timings, clock, reply]() {
+        timings->finished = clock->elapsed();
+        timings->http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    });
+
+    return timings;
+}
+
+// LOG
+
+UploadTimingLog::UploadTimingLog()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(dir);
+    m_path = dir + QStringLiteral("/upload-timings.jsonl");
+}
+
+UploadTimingLog* UploadTimingLog::instance()
+{
+    static UploadTimingLog log;
+    return &log;
+}
+
+void UploadTimingLog::record(const UploadTimings& timings)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QQueue<UploadTimings>& recent = m_recent[timings.endpoint];
+    recent.enqueue(timings);
+    while (recent.size() > TIMINGS_RECENT_PER_ENDPOINT) {
+        recent.dequeue();
+    }
+
+    QFile file(m_path);
+    if (file.size() > TIMINGS_LOG_MAX_SIZE) {
+        QFile::remove(m_path + QStringLiteral(".1"));
+        file.rename(m_path + QStringLiteral(".1"));
+        file.setFileName(m_path);
+    }
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write(QJsonDocument(timings.toJson()).toJson(QJsonDocument::Compact) + '\n');
+    }
+}
+
+QJsonArray UploadTimingLog::recent(const QString& endpoint) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonArray result;
+    for (auto it = m_recent.constBegin(); it != m_recent.constEnd(); ++it) {
+        if (!endpoint.isEmpty() && it.key() != endpoint) {
+            continue;
+        }
+        for (auto timing = it->crbegin(); timing != it->crend(); ++timing) {
+            result.append(timing->toJson());
+        }
+    }
+    return result;
+}
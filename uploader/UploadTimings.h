@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef UPLOADTIMINGS_H
+#define UPLOADTIMINGS_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QString>
+
+class QNetworkReply;
+
+/**
+ * @brief When each phase of one upload request happened, in milliseconds
+ * after the request was issued. -1 means the phase wasn't observed.
+ *
+ * Qt doesn't report host lookup separately, so `connectStart` marks the end
+ * of queueing and the start of lookup + TCP connect. On a reused connection
+ * neither it nor `encrypted` happen.
+ *
+ * `timeToUrl` is set by the uploader and spans the whole upload, including
+ * hashing and retries; comparing it between reused (warm) and new (cold)
+ * connections shows what pre-connecting saves.
+ */
+struct UploadTimings
+{
+    QString endpoint; // scheme://host:port
+    qint64 startedAt = 0; // ms since epoch
+    qint64 bytes = 0;
+    bool connectionReused = true;
+    bool http2 = false;
+
+    qint64 connectStart = -1;
+    qint64 encrypted = -1;
+    qint64 requestSent = -1;
+    qint64 firstByte = -1;
+    qint64 finished = -1;
+    qint64 timeToUrl = -1;
+
+    // Durations of the phases, -1 where unknown
+    qint64 connectMs() const;
+    qint64 uploadMs() const;
+    qint64 serverMs() const;
+
+    QString summary() const;
+    QJsonObject toJson() const;
+
+    /**
+     * @brief Record the timings of `reply`. Must be called right after the
+     * request is issued; the result is complete once `finished()` was emitted.
+     */
+    static QSharedPointer<UploadTimings> track(QNetworkReply* reply);
+};
+
+/**
+ * @brief Recent upload timings, kept in memory for queries and appended to
+ * `upload-timings.jsonl` in the cache directory for offline histograms.
+ *
+ * Safe to use from any thread.
+ */
+class UploadTimingLog
+{
+public:
+    static UploadTimingLog* instance();
+
+    void record(const UploadTimings& timings);
+    // Most recent first per endpoint, all endpoints if `endpoint` is empty
+    QJsonArray recent(const QString& endpoint = {}) const;
+
+private:
+    UploadTimingLog();
+
+    mutable QMutex m_mutex;
+    QString m_path;
+    QHash<QString, QQueue<UploadTimings>> m_recent;
+};
+
+#endif // UPLOADTIMINGS_H
@@ -24,8 +24,10 @@
 #include <QUrlQuery>
 #include <QVBoxLayout>
 
+#include "../utils/abstractlogger.h"
 #include "../utils/clipboard.h"
 #include "../utils/widgets/imagelabel.h"
+#include "UploadSource.h"
 
 using namespace Flowshot;
 
@@ -47,7 +49,8 @@ void ImgUploaderBase::Init()
 {
     setWindowOpacity(0.95);
     Clipboard::copyToClipboard("");
-    if (!ConfigHandler().uploadWindowEnabled()) {
+    m_uploadWindowEnabled = ConfigHandler().uploadWindowEnabled();
+    if (!m_uploadWindowEnabled) {
         return;
     }
     setWindowTitle(tr("Upload image"));
@@ -93,10 +96,7 @@ void ImgUploaderBase::Init()
                                  "float: right;"
                                  "}");
 
-    connect(m_closeButton, &QPushButton::clicked, this, [this]() {
-        close();
-        emit dialogClosed(m_hasUploaded);
-    });
+    connect(m_closeButton, &QPushButton::clicked, this, &ImgUploaderBase::dismiss);
 
     m_vLayout = new QVBoxLayout();
     setLayout(m_vLayout);
@@ -107,10 +107,7 @@ void ImgUploaderBase::Init()
     m_closeTimer = new QTimer(this);
     m_closeTimer->setSingleShot(true);
     m_closeTimer->setInterval(ConfigHandler().uploadWindowTimeout());
-    connect(m_closeTimer, &QTimer::timeout, this, [this]() {
-        close();
-        emit dialogClosed(m_hasUploaded);
-    });
+    connect(m_closeTimer, &QTimer::timeout, this, &ImgUploaderBase::dismiss);
 }
 
 void ImgUploaderBase::usePrimaryScreen() {
@@ -146,6 +143,48 @@ void ImgUploaderBase::leaveEvent(QEvent *event) {
 
 void ImgUploaderBase::contextMenuEvent(QContextMenuEvent* event)
 {
+    dismiss();
+}
+
+bool ImgUploaderBase::isUploading() const
+{
+    return !m_urlReported && !m_uploadFailed && !m_cancelled;
+}
+
+void ImgUploaderBase::dismiss()
+{
+    // A failed upload is left to the journal, a running one isn't waited for
+    if (isUploading()) {
+        cancel();
+        return;
+    }
+    closeWindow();
+}
+
+void ImgUploaderBase::cancel()
+{
+    if (!m_urlReported && !m_cancelled) {
+        AbstractLogger::info() << QStringLiteral("Upload cancelled");
+        m_cancelled = true;
+        cancelUpload();
+        emit uploadCancelled();
+    }
+    closeWindow();
+}
+
+void ImgUploaderBase::closeWindow()
+{
+    // The close timer may still fire after a cancel
+    if (m_closed) {
+        return;
+    }
+    m_closed = true;
+    if (m_closeTimer != nullptr) {
+        m_closeTimer->stop();
+    }
+    if (!m_urlReported) {
+        emit uploadFinished(QUrl());
+    }
     close();
     emit dialogClosed(m_hasUploaded);
 }
@@ -185,6 +224,35 @@ void ImgUploaderBase::setInfoLabelText(const QString& text)
     m_infoLabel->setText(text);
 }
 
+const QSharedPointer<UploadSource>& ImgUploaderBase::source()
+{
+    return m_source;
+}
+
+void ImgUploaderBase::setSource(const QSharedPointer<UploadSource>& source)
+{
+    m_source = source;
+}
+
+void ImgUploaderBase::reportUrl(const QUrl& url)
+{
+    if (m_urlReported) {
+        AbstractLogger::info() << QStringLiteral("Mirrored to %1").arg(url.toString());
+        m_mirrorUrls.append(url);
+        emit mirrorUploaded(url);
+        return;
+    }
+    m_urlReported = true;
+    setImageURL(url);
+    emit uploadOk(url);
+    emit uploadFinished(url);
+}
+
+const QList<QUrl>& ImgUploaderBase::mirrorUrls()
+{
+    return m_mirrorUrls;
+}
+
 void ImgUploaderBase::startDrag()
 {
     //
@@ -201,18 +269,28 @@ void ImgUploaderBase::showPreUploadDialog(int open)
     move(QPoint(x(), y() - offset));
 }
 
-void ImgUploaderBase::updateProgress(int percentage, double speed)
+void ImgUploaderBase::updateProgress(int percentage, double speed, int etaSeconds)
 {
-    if (!m_infoLabel || !ConfigHandler().uploadWindowEnabled()) {
+    if (!m_infoLabel || !m_uploadWindowEnabled) {
         return;
     }
 
-    m_infoLabel->setText(tr("Uploading file... %1% (%2Mbps)").arg(percentage).arg(speed));
+    QString text = etaSeconds >= 0
+                     ? tr("Uploading file... %1% (%2 Mbps, %3 s left)")
+                         .arg(percentage)
+                         .arg(speed, 0, 'f', 1)
+                         .arg(etaSeconds)
+                     : tr("Uploading file... %1% (%2 Mbps)").arg(percentage).arg(speed, 0, 'f', 1);
+    // Relabelling relayouts the widget, skip it when nothing visible changed
+    if (text != m_infoLabel->text()) {
+        m_infoLabel->setText(text);
+    }
 }
 
 void ImgUploaderBase::showErrorUploadDialog(QNetworkReply* error)
 {
     if (!ConfigHandler().uploadWindowEnabled()) {
+        showUploadErrorMessage(error->errorString());
         return;
     }
     QJsonDocument jsonResponse = QJsonDocument::fromJson(error->readAll());
@@ -224,17 +302,35 @@ void ImgUploaderBase::showErrorUploadDialog(QNetworkReply* error)
         if (!errorsArray.isEmpty()) {
             QJsonObject firstErrorObject = errorsArray[0].toObject();
             QString errorMessage = firstErrorObject["message"].toString();
-            m_infoLabel->setText(tr("%1").arg(errorMessage));
+            showUploadErrorMessage(tr("%1").arg(errorMessage));
+            return;
         }
+        showUploadErrorMessage(m_infoLabel->text());
     } else {
-        m_infoLabel->setText(tr("Error uploading file: %1")
-                               .arg(error->errorString()));
+        showUploadErrorMessage(tr("Error uploading file: %1")
+                                 .arg(error->errorString()));
+    }
+}
+
+void ImgUploaderBase::showUploadErrorMessage(const QString& message, bool retryable)
+{
+    m_uploadFailed = true;
+    if (!ConfigHandler().uploadWindowEnabled()) {
+        // No window to retry in or to close, finish the upload right away
+        AbstractLogger::warning() << QStringLiteral("Upload failed: %1").arg(message);
+        closeWindow();
+        return;
     }
+    m_infoLabel->setText(message);
     m_closeTimer->start();
-    if(m_retryButton == nullptr) {
+    if(retryable && m_retryButton == nullptr) {
         m_retryButton = new QPushButton(tr("Retry"));
-        connect(
-          m_retryButton, &QPushButton::clicked, this, &ImgUploaderBase::upload);
+        connect(m_retryButton, &QPushButton::clicked, this, [this]() {
+            // The retry runs in this window, closing it cancels the retry
+            m_uploadFailed = false;
+            m_closeTimer->stop();
+            upload();
+        });
 
         m_vLayout->addWidget(m_retryButton);
     }
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <QList>
+#include <QSharedPointer>
 #include <QUrl>
 #include <QWidget>
 #include "../utils/ConfigHandler.h"
@@ -16,6 +18,7 @@ class LoadSpinner;
 class QPushButton;
 class QUrl;
 class NotificationWidget;
+class UploadSource;
 
 namespace Flowshot
 {
@@ -37,23 +40,50 @@ namespace Flowshot
         void setFilePath(const QString&);
         void setPixmap(const QPixmap&);
         void setInfoLabelText(const QString&);
+        // Payload to upload instead of reading filePath() or encoding pixmap(),
+        // shared with mirrors of this upload
+        const QSharedPointer<UploadSource>& source();
+        void setSource(const QSharedPointer<UploadSource>& source);
+
+        /**
+         * @brief Report a URL of this upload or of one of its mirrors. The
+         * first one is the result and is emitted as uploadOk(), later ones
+         * are recorded as mirrors.
+         */
+        void reportUrl(const QUrl& url);
+        const QList<QUrl>& mirrorUrls();
 
         virtual void deleteImage(const QString& fileName,
                                  const QString& deleteToken) = 0;
         virtual void upload() = 0;
 
+        // Neither a URL nor an error yet, and not cancelled
+        bool isUploading() const;
+
     signals:
         void uploadOk(const QUrl& url);
         void deleteOk();
-        void uploadProgress(int progress, double speed);
+        void uploadProgress(int progress, double speed, int etaSeconds);
         void uploadSpeed(double speed);
         void uploadError(QNetworkReply* error);
         void dialogClosed(bool success);
+        void mirrorUploaded(const QUrl& url);
+        // The upload was given up before it had a URL, emitted before dialogClosed()
+        void uploadCancelled();
+        // Exactly once: the URL, or an empty one when the window closes without it
+        void uploadFinished(const QUrl& url);
 
     public slots:
+        /**
+         * @brief Close the window, like its close button does. An upload that
+         * is still running is cancelled, a failed one is kept for the journal.
+         */
+        void dismiss();
+        // Give up on the upload, running or failed, and close the window
+        void cancel();
         void showPostUploadDialog(int open);
         void showPreUploadDialog(int open);
-        void updateProgress(int percentage, double speed);
+        void updateProgress(int percentage, double speed, int etaSeconds = -1);
 
     private slots:
         void startDrag();
@@ -66,6 +96,12 @@ namespace Flowshot
     private:
         QPixmap m_pixmap;
         QString m_filePath;
+        QSharedPointer<UploadSource> m_source;
+        bool m_urlReported = false;
+        bool m_uploadFailed = false;
+        bool m_cancelled = false;
+        bool m_closed = false;
+        QList<QUrl> m_mirrorUrls;
 
         QVBoxLayout* m_vLayout;
         QHBoxLayout* m_hLayout;
@@ -81,15 +117,21 @@ namespace Flowshot
         QPushButton* m_closeButton;
         QUrl m_imageURL;
         NotificationWidget* m_notification;
-        QTimer* m_closeTimer;
+        QTimer* m_closeTimer = nullptr;
         QPushButton* m_retryButton = nullptr;
         bool m_hasUploaded;
         int m_remainingTimeOnPause = -1;
         QLabel* m_label;
         void usePrimaryScreen();
+        void closeWindow();
         bool m_postUploadLayoutAdded = false;
+        // Read once, updateProgress runs several times a second
+        bool m_uploadWindowEnabled = false;
 
     protected:
+        // Abort the transfer and free what it holds; the window closes anyway
+        virtual void cancelUpload() {}
+
         void contextMenuEvent(QContextMenuEvent* event) override;
         void enterEvent(QEnterEvent *event) override;
         void leaveEvent(QEvent *event) override;
@@ -97,5 +139,7 @@ namespace Flowshot
     public:
         QString m_currentImageName;
         void showErrorUploadDialog(QNetworkReply* error);
+        // For backends whose errors don't come with a reply
+        void showUploadErrorMessage(const QString& message, bool retryable = true);
     };
 }
\ No newline at end of file
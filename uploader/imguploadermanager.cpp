@@ -3,12 +3,23 @@
 //
 
 #include "imguploadermanager.h"
+#include <QBuffer>
+#include <QFileInfo>
+#include <QMimeDatabase>
 #include <QPixmap>
+#include <QPointer>
 #include <QWidget>
 
-// TODO - remove this hard-code and create plugin manager in the future, you may
-// include other storage headers here
+#include "../utils/ConfigHandler.h"
+#include "../utils/abstractlogger.h"
+#include "../utils/filenamehandler.h"
+#include "UploadNetwork.h"
+#include "UploadScheduler.h"
+#include "UploadSource.h"
+#include "privateuploader/PrivateUploaderUploadHandler.h"
 #include "privateuploader/privateuploader.h"
+#include "s3/S3MultipartUpload.h"
+#include "s3/S3Uploader.h"
 
 using namespace Flowshot;
 
@@ -16,43 +27,188 @@ ImgUploaderManager::ImgUploaderManager(QObject* parent)
     : QObject(parent)
       , m_imgUploaderBase(nullptr)
 {
-    // TODO - implement ImgUploader for other Storages and selection among them
     m_imgUploaderPlugin = IMG_UPLOADER_STORAGE_DEFAULT;
     init();
 }
 
+QHash<QString, ImgUploaderManager::Backend>& ImgUploaderManager::registry()
+{
+    static QHash<QString, Backend> backends = {
+        { QStringLiteral("privateuploader"),
+          { [](const QPixmap& capture, const QString& path, QWidget* parent, bool fromScreenshotUtility) {
+                return path.isNull()
+                         ? static_cast<ImgUploaderBase*>(new PrivateUploader(capture, parent, fromScreenshotUtility))
+                         : static_cast<ImgUploaderBase*>(new PrivateUploader(path, parent, fromScreenshotUtility));
+            },
+            [](const MirrorJob& job, QObject* context, MirrorDone done) {
+                // Deleted with the context, which aborts the upload
+                auto* uploader = new PrivateUploaderUploadHandler(context);
+                QObject::connect(uploader,
+                                 &PrivateUploaderUploadHandler::uploadOk,
+                                 context,
+                                 [uploader, done](FlowinityValidUploadResponse response) {
+                                     uploader->deleteLater();
+                                     done(QUrl(response.getUrl()), {});
+                                 });
+                QObject::connect(uploader, &PrivateUploaderUploadHandler::uploadError, context, [uploader, done]() {
+                    uploader->deleteLater();
+                    done({}, QStringLiteral("the server rejected the upload"));
+                });
+                uploader->uploadSource(job.source, job.filePath, job.fileName, job.fileType);
+            },
+            // PrivateUploaderUploadV2 encrypts the source itself
+            true } },
+        { QStringLiteral("s3"),
+          { [](const QPixmap& capture, const QString& path, QWidget* parent, bool fromScreenshotUtility) {
+                return path.isNull()
+                         ? static_cast<ImgUploaderBase*>(new S3Uploader(capture, parent, fromScreenshotUtility))
+                         : static_cast<ImgUploaderBase*>(new S3Uploader(path, parent, fromScreenshotUtility));
+            },
+            [](const MirrorJob& job, QObject* context, MirrorDone done) {
+                auto* worker = new S3MultipartUpload(UploadNetwork::instance()->networkAccessManager());
+                worker->moveToThread(UploadNetwork::instance()->thread());
+                QObject::connect(worker, &S3MultipartUpload::uploadOk, context, [done](const QString& url) {
+                    done(QUrl(url), {});
+                });
+                QObject::connect(worker, &S3MultipartUpload::uploadError, context, [done](const QString& message) {
+                    done({}, message);
+                });
+                QObject::connect(worker, &S3MultipartUpload::uploadFinished, worker, &QObject::deleteLater);
+                QObject::connect(context, &QObject::destroyed, worker, &QObject::deleteLater);
+                UploadScheduler::instance()->submit(worker, [worker, job]() {
+                    worker->uploadSource(job.source, job.fileName, job.fileType);
+                }, UploadPriority::Bulk, job.source->size());
+            },
+            // S3MultipartUpload encrypts the source itself
+            true } },
+    };
+    return backends;
+}
+
+void ImgUploaderManager::registerBackend(const QString& name, Factory factory, Mirror mirror, bool encrypts)
+{
+    registry().insert(name.toLower(), { std::move(factory), std::move(mirror), encrypts });
+}
+
+QStringList ImgUploaderManager::backends()
+{
+    return registry().keys();
+}
+
 void ImgUploaderManager::init()
 {
-    // TODO - implement ImgUploader for other Storages and selection among them,
-    // example:
-    // if (uploaderPlugin().compare("s3") == 0) {
-    //    m_qstrUrl = ImgS3Settings().value("S3", "S3_URL").toString();
-    //} else {
-    //    m_qstrUrl = "https://imgur.com/";
-    //    m_imgUploaderPlugin = "imgur";
-    //}
-    m_urlString = "https://flowinity.com/";
-    m_imgUploaderPlugin = "privateuploader";
+    ConfigHandler config;
+    QString backend = config.uploaderBackend().trimmed().toLower();
+    if (registry().contains(backend)) {
+        m_imgUploaderPlugin = backend;
+    } else {
+        AbstractLogger::warning() << QStringLiteral("Unknown uploader backend \"%1\", using %2")
+                                       .arg(backend, QStringLiteral(IMG_UPLOADER_STORAGE_DEFAULT));
+        m_imgUploaderPlugin = IMG_UPLOADER_STORAGE_DEFAULT;
+    }
+
+    if (m_imgUploaderPlugin == QLatin1String("s3")) {
+        m_urlString = config.s3PublicUrl();
+        if (m_urlString.isEmpty()) {
+            m_urlString = config.s3Endpoint();
+        }
+    } else {
+        m_urlString = "https://flowinity.com/";
+    }
+
+    m_refusePlaintext = config.uploadEncrypt() && !registry().value(m_imgUploaderPlugin).encrypts;
+    if (m_refusePlaintext) {
+        AbstractLogger::error() << QStringLiteral("Uploader backend \"%1\" can't encrypt, not uploading while uploadEncrypt is on")
+                                     .arg(m_imgUploaderPlugin);
+    }
+
+    m_mirrors.clear();
+    const QStringList mirrors = config.uploadMirrors().toLower().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    for (const QString& mirror : mirrors) {
+        if (mirror == m_imgUploaderPlugin || m_mirrors.contains(mirror)) {
+            continue;
+        }
+        if (!registry().value(mirror).mirror) {
+            AbstractLogger::warning() << QStringLiteral("Uploader backend \"%1\" can't be used as a mirror").arg(mirror);
+            continue;
+        }
+        if (config.uploadEncrypt() && !registry().value(mirror).encrypts) {
+            AbstractLogger::warning() << QStringLiteral("Uploader backend \"%1\" can't encrypt, not mirroring to it while uploadEncrypt is on")
+                                           .arg(mirror);
+            continue;
+        }
+        m_mirrors.append(mirror);
+    }
+}
+
+void ImgUploaderManager::startMirrors(const QPixmap& capture, const QString& path, bool fromScreenshotUtility)
+{
+    MirrorJob job;
+    if (!path.isNull()) {
+        job.source = openFileSource(path);
+        job.filePath = path;
+        job.fileType = QMimeDatabase().mimeTypeForFile(path).name();
+    } else {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        capture.save(&buffer, "PNG");
+        job.source = QSharedPointer<UploadSource>(new ByteArraySource(bytes));
+        job.fileType = QStringLiteral("image/png");
+    }
+    if (job.source.isNull()) {
+        AbstractLogger::warning() << QStringLiteral("Could not open %1, not mirroring it").arg(path);
+        return;
+    }
+    job.fileName = fromScreenshotUtility || path.isNull()
+                     ? FileNameHandler().parsedPattern() + ".png"
+                     : FileNameHandler().parseFilename(QFileInfo(path).fileName());
+
+    // One reader per destination over the same pages
+    QList<QSharedPointer<UploadSource>> readers = fanOutSource(job.source, int(m_mirrors.size()) + 1);
+    m_imgUploaderBase->setSource(readers.takeFirst());
+
+    // Owns the mirror uploads of this window, dismissing it early aborts them
+    auto* mirrors = new QObject(this);
+    connect(m_imgUploaderBase, &ImgUploaderBase::uploadCancelled, mirrors, &QObject::deleteLater);
+    auto remaining = QSharedPointer<int>::create(int(m_mirrors.size()));
+
+    QPointer<ImgUploaderBase> primary = m_imgUploaderBase;
+    for (const QString& mirror : std::as_const(m_mirrors)) {
+        job.source = readers.takeFirst();
+        registry().value(mirror).mirror(job, mirrors, [primary, mirror, mirrors, remaining](const QUrl& url, const QString& error) {
+            if (--*remaining == 0) {
+                mirrors->deleteLater();
+            }
+            if (url.isEmpty()) {
+                AbstractLogger::warning() << QStringLiteral("Mirroring to %1 failed: %2").arg(mirror, error);
+            } else if (primary) {
+                primary->reportUrl(url);
+            } else {
+                AbstractLogger::info() << QStringLiteral("Mirrored to %1: %2").arg(mirror, url.toString());
+            }
+        });
+    }
 }
 
 ImgUploaderBase* ImgUploaderManager::uploader(const QPixmap& capture,
                                               bool fromScreenshotUtility,
                                               QWidget* parent)
 {
-    // TODO - implement ImgUploader for other Storages and selection among them,
-    // example:
-    // if (uploaderPlugin().compare("s3") == 0) {
-    //    m_imgUploaderBase =
-    //      (ImgUploaderBase*)(new ImgS3Uploader(capture, parent));
-    //} else {
-    //    m_imgUploaderBase =
-    //      (ImgUploaderBase*)(new ImgurUploader(capture, parent));
-    //}
     m_imgUploaderBase =
-        (ImgUploaderBase*)(new PrivateUploader(capture, parent, fromScreenshotUtility));
+        registry().value(m_imgUploaderPlugin).factory(capture, QString(), parent, fromScreenshotUtility);
     if (m_imgUploaderBase && !capture.isNull())
     {
-        m_imgUploaderBase->upload();
+        if (m_refusePlaintext) {
+            // Queued, the caller connects to the window after this returns
+            QMetaObject::invokeMethod(m_imgUploaderBase, [uploader = m_imgUploaderBase]() {
+                uploader->showUploadErrorMessage(tr("This uploader can't encrypt the upload"), false);
+            }, Qt::QueuedConnection);
+        } else {
+            if (!m_mirrors.isEmpty()) {
+                startMirrors(capture, QString(), fromScreenshotUtility);
+            }
+            m_imgUploaderBase->upload();
+        }
     }
 
     // connect(m_imgUploaderBase, &ImgUploaderBase::upload, this, [this](ImgUploaderBase* uploader){
@@ -66,20 +222,21 @@ ImgUploaderBase* ImgUploaderManager::uploader(const QString& path,
                                               bool fromScreenshotUtility,
                                               QWidget* parent)
 {
-    // TODO - implement ImgUploader for other Storages and selection among them,
-    // example:
-    // if (uploaderPlugin().compare("s3") == 0) {
-    //    m_imgUploaderBase =
-    //      (ImgUploaderBase*)(new ImgS3Uploader(capture, parent));
-    //} else {
-    //    m_imgUploaderBase =
-    //      (ImgUploaderBase*)(new ImgurUploader(capture, parent));
-    //}
     m_imgUploaderBase =
-        (ImgUploaderBase*)(new PrivateUploader(path, parent, fromScreenshotUtility));
+        registry().value(m_imgUploaderPlugin).factory(QPixmap(), path, parent, fromScreenshotUtility);
     if (m_imgUploaderBase && !path.isNull())
     {
-        m_imgUploaderBase->upload();
+        if (m_refusePlaintext) {
+            // Queued, the caller connects to the window after this returns
+            QMetaObject::invokeMethod(m_imgUploaderBase, [uploader = m_imgUploaderBase]() {
+                uploader->showUploadErrorMessage(tr("This uploader can't encrypt the upload"), false);
+            }, Qt::QueuedConnection);
+        } else {
+            if (!m_mirrors.isEmpty()) {
+                startMirrors(QPixmap(), path, fromScreenshotUtility);
+            }
+            m_imgUploaderBase->upload();
+        }
     }
 
     // connect(m_imgUploaderBase, &ImgUploaderBase::upload, this, [this](ImgUploaderBase* uploader){
@@ -88,6 +245,26 @@ ImgUploaderBase* ImgUploaderManager::uploader(const QString& path,
     return m_imgUploaderBase;
 }
 
+void ImgUploaderManager::uploadInBackground(const QString& path, QObject* context, MirrorDone done, const QString& fileName)
+{
+    if (m_refusePlaintext) {
+        done({}, QStringLiteral("the backend can't encrypt the upload"));
+        return;
+    }
+    Mirror upload = registry().value(m_imgUploaderPlugin).mirror;
+    MirrorJob job;
+    job.source = openFileSource(path);
+    if (!upload || job.source.isNull()) {
+        done({}, upload ? QStringLiteral("the file can't be read")
+                        : QStringLiteral("the backend can't upload in the background"));
+        return;
+    }
+    job.filePath = path;
+    job.fileName = fileName.isEmpty() ? FileNameHandler().parseFilename(QFileInfo(path).fileName()) : fileName;
+    job.fileType = QMimeDatabase().mimeTypeForFile(path).name();
+    upload(job, context, std::move(done));
+}
+
 const QString& ImgUploaderManager::uploaderPlugin()
 {
     return m_imgUploaderPlugin;
@@ -6,27 +6,74 @@
 #define FLAMESHOT_IMGUPLOADERMANAGER_H
 
 #include "imguploaderbase.h"
+#include <QHash>
 #include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <functional>
 
 #define IMG_UPLOADER_STORAGE_DEFAULT "privateuploader"
 
 class QPixmap;
 class QWidget;
+class UploadSource;
 
 using namespace Flowshot;
 
+/**
+ * @brief Creates the upload window of the backend selected by the
+ * `uploaderBackend` option.
+ *
+ * Backends register a factory under their config name. "privateuploader"
+ * (Flowinity) and "s3" are built in; unknown names fall back to the default.
+ *
+ * Backends listed in `uploadMirrors` receive a copy of every upload, in the
+ * background and concurrently with the main one. The file is opened once and
+ * its pages are shared by all destinations. The first URL from any of them
+ * is the result, the others are recorded as mirrors on the window. Mirrors
+ * are aborted with the upload when its window is dismissed early.
+ *
+ * A backend registered with `encrypts` honours `uploadEncrypt`; both built-in
+ * ones do. While that option is on, the others are left out of the mirrors,
+ * and as the selected backend their uploads fail instead of sending the
+ * plain file.
+ */
 class ImgUploaderManager : public QObject
 {
     Q_OBJECT
 public:
+    // Exactly one of `capture` and `path` is set
+    using Factory = std::function<ImgUploaderBase*(const QPixmap& capture,
+                                                   const QString& path,
+                                                   QWidget* parent,
+                                                   bool fromScreenshotUtility)>;
+
+    struct MirrorJob
+    {
+        QSharedPointer<UploadSource> source;
+        QString filePath; // empty for captures that only exist in memory
+        QString fileName;
+        QString fileType;
+    };
+    // Called on the thread of the context with the URL, or an empty URL and the error
+    using MirrorDone = std::function<void(const QUrl& url, const QString& error)>;
+    // Uploads `job` without a window, aborted if `context` is destroyed first
+    using Mirror = std::function<void(const MirrorJob& job, QObject* context, MirrorDone done)>;
+
     explicit ImgUploaderManager(QObject* parent = nullptr);
 
+    static void registerBackend(const QString& name, Factory factory, Mirror mirror = {}, bool encrypts = false);
+    static QStringList backends();
+
     ImgUploaderBase* uploader(const QPixmap& capture,
                               bool fromScreenshotUtility,
                               QWidget* parent = nullptr);
     ImgUploaderBase* uploader(const QString& path,
                               bool fromScreenshotUtility,
                               QWidget* parent = nullptr);
+    // Upload a file without a window through the selected backend, under
+    // `fileName` or the name parsed from `path`
+    void uploadInBackground(const QString& path, QObject* context, MirrorDone done, const QString& fileName = {});
     const QString& url();
     const QString& uploaderPlugin();
 
@@ -34,12 +81,24 @@ signals:
     // void uploadFinished(ImgUploaderBase* uploader);
 
 private:
+    struct Backend
+    {
+        Factory factory;
+        Mirror mirror;
+        bool encrypts = false;
+    };
+
     void init();
+    void startMirrors(const QPixmap& capture, const QString& path, bool fromScreenshotUtility);
+    static QHash<QString, Backend>& registry();
 
 private:
     ImgUploaderBase* m_imgUploaderBase;
     QString m_urlString;
     QString m_imgUploaderPlugin;
+    QStringList m_mirrors;
+    // uploadEncrypt is on and the selected backend can't encrypt
+    bool m_refusePlaintext = false;
 
 };
 
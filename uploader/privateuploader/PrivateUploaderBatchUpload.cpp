@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "PrivateUploaderBatchUpload.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include "../../utils/ConfigHandler.h"
+#include "../../utils/abstractlogger.h"
+#include "../../utils/rng.h"
+#include "../ApiEndpointPool.h"
+#include "../CircuitBreaker.h"
+#include "../StreamingUploadDevice.h"
+#include "../UploadSource.h"
+
+// The first error message of an `{"errors": [{"message"}]}` object
+static QString errorMessage(const QJsonObject& object)
+{
+    QJsonArray errors = object.value(QStringLiteral("errors")).toArray();
+    QString message = errors.isEmpty() ? QString()
+                                       : errors.first().toObject().value(QStringLiteral("message")).toString();
+    return message.isEmpty() ? QStringLiteral("the server didn't return a URL") : message;
+}
+
+PrivateUploaderBatchUpload::PrivateUploaderBatchUpload(QNetworkAccessManager* networkAM, QObject* parent)
+  : QObject(parent)
+  , m_NetworkAM(networkAM)
+  , m_retryTimer(new QTimer(this))
+{
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &PrivateUploaderBatchUpload::send);
+}
+
+PrivateUploaderBatchUpload::~PrivateUploaderBatchUpload()
+{
+    cancelUpload();
+}
+
+void PrivateUploaderBatchUpload::setPriority(UploadPriority priority)
+{
+    m_priority = priority;
+}
+
+void PrivateUploaderBatchUpload::cancelUpload()
+{
+    m_retryTimer->stop();
+    if (m_currentReply) {
+        // Don't report the abort as an upload error
+        m_currentReply->disconnect(this);
+        m_currentReply->abort();
+        m_currentReply->deleteLater();
+        m_currentReply = nullptr;
+    }
+    if (m_body) {
+        m_body->deleteLater();
+        m_body = nullptr;
+    }
+}
+
+void PrivateUploaderBatchUpload::uploadFiles(const QList<File>& files)
+{
+    QByteArray boundary = ("BoUnDaRy-" + Flowshot::randomString(16)).toUtf8();
+    m_files.clear();
+    m_body = new StreamingUploadDevice(this);
+
+    for (const File& file : files) {
+        QSharedPointer<UploadSource> source = openFileSource(file.filePath);
+        if (source.isNull()) {
+            emit fileFailed(file.filePath, QStringLiteral("the file can't be read"));
+            continue;
+        }
+        m_files.append(file);
+        m_body->appendFormDataPart(boundary, QStringLiteral("attachment"), file.fileName, file.fileType, source);
+    }
+    m_body->appendClosingBoundary(boundary);
+
+    if (m_files.isEmpty()) {
+        finish();
+        return;
+    }
+
+    m_body->setPriority(m_priority);
+    m_body->open(QIODevice::ReadOnly);
+
+    // The URL is chosen per attempt in send
+    m_request = QNetworkRequest();
+    m_request.setRawHeader("Authorization", ConfigHandler().uploadTokenTPU().toUtf8());
+    m_request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("multipart/form-data; boundary=" + boundary));
+    m_request.setHeader(QNetworkRequest::ContentLengthHeader, m_body->size());
+
+    m_retry = RetryPolicy(ConfigHandler().uploadMaxRetries());
+    m_progress.reset();
+    send();
+}
+
+void PrivateUploaderBatchUpload::send()
+{
+    m_endpoint = ApiEndpointPool::instance()->pick();
+    m_request.setUrl(QUrl(QStringLiteral("%1/gallery").arg(m_endpoint)));
+    m_breaker = CircuitBreaker::forEndpoint(m_request.url());
+
+    qint64 wait = m_breaker->acquire();
+    if (wait > 0) {
+        m_retryTimer->start(int(wait));
+        return;
+    }
+
+    m_body->reset();
+    m_currentReply = m_NetworkAM->post(m_request, m_body);
+
+    connect(m_currentReply, &QNetworkReply::uploadProgress, this, [this](qint64 sent, qint64 total) {
+        if (m_progress.update(sent, total)) {
+            emit uploadProgress(m_progress.percent(), m_progress.megabitsPerSecond(), m_progress.etaSeconds());
+        }
+    });
+
+    connect(m_currentReply, &QNetworkReply::finished, this, [this]() {
+        QNetworkReply* reply = m_currentReply;
+        m_currentReply = nullptr;
+        reply->deleteLater();
+
+        if (reply->error() == QNetworkReply::NoError) {
+            m_breaker->recordSuccess();
+            ApiEndpointPool::instance()->recordSuccess(m_endpoint);
+            handleReply(reply);
+            return;
+        }
+
+        RetryPolicy::ErrorClass errorClass = RetryPolicy::classify(reply);
+        if (RetryPolicy::isRetryable(errorClass)) {
+            m_breaker->recordFailure();
+            if (errorClass != RetryPolicy::ErrorClass::RateLimited) {
+                ApiEndpointPool::instance()->recordFailure(m_endpoint);
+            }
+        } else if (errorClass == RetryPolicy::ErrorClass::Permanent &&
+                   reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+            m_breaker->recordSuccess();
+        }
+
+        qint64 delay = m_retry.nextDelay(reply);
+        if (delay >= 0) {
+            AbstractLogger::warning() << QStringLiteral("Batch upload of %1 files failed (%2), retry %3 in %4 ms")
+                                           .arg(m_files.size())
+                                           .arg(reply->errorString())
+                                           .arg(m_retry.retries())
+                                           .arg(delay);
+            m_retryTimer->start(int(delay));
+            return;
+        }
+        failAll(reply->errorString());
+    });
+}
+
+void PrivateUploaderBatchUpload::handleReply(QNetworkReply* reply)
+{
+    QJsonDocument document = QJsonDocument::fromJson(reply->readAll());
+    QJsonArray results = document.array();
+
+    if (!document.isArray() || results.size() != m_files.size()) {
+        // Not one result per part: the server took at most the first part,
+        // the rest go up one by one
+        QString url = document.object().value(QStringLiteral("url")).toString();
+        QStringList remaining;
+        for (qsizetype i = 0; i < m_files.size(); ++i) {
+            if (i == 0 && !url.isEmpty()) {
+                emit fileUploaded(FlowinityValidUploadResponse(url, m_files.first().filePath));
+            } else {
+                remaining.append(m_files.at(i).filePath);
+            }
+        }
+        if (!remaining.isEmpty()) {
+            AbstractLogger::warning() << QStringLiteral("The server doesn't support batch uploads");
+            emit batchUnsupported(remaining);
+        }
+        finish();
+        return;
+    }
+
+    for (qsizetype i = 0; i < m_files.size(); ++i) {
+        QJsonObject result = results.at(i).toObject();
+        QString url = result.value(QStringLiteral("url")).toString();
+        if (url.isEmpty()) {
+            emit fileFailed(m_files.at(i).filePath, errorMessage(result));
+        } else {
+            emit fileUploaded(FlowinityValidUploadResponse(url, m_files.at(i).filePath));
+        }
+    }
+    finish();
+}
+
+void PrivateUploaderBatchUpload::failAll(const QString& error)
+{
+    for (const File& file : std::as_const(m_files)) {
+        emit fileFailed(file.filePath, error);
+    }
+    finish();
+}
+
+void PrivateUploaderBatchUpload::finish()
+{
+    m_files.clear();
+    if (m_body) {
+        m_body->deleteLater();
+        m_body = nullptr;
+    }
+    emit uploadFinished();
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef PRIVATEUPLOADERBATCHUPLOAD_H
+#define PRIVATEUPLOADERBATCHUPLOAD_H
+
+#include <QList>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include "responses/FlowinityValidUploadResponse.h"
+#include "../RetryPolicy.h"
+#include "../UploadPriority.h"
+#include "../UploadProgressEstimator.h"
+
+class CircuitBreaker;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+class StreamingUploadDevice;
+
+/**
+ * @brief Uploads several small files in one request, so that a folder of
+ * thumbnails costs a handful of POSTs instead of one per file.
+ *
+ * `POST /gallery` carries one `attachment` part per file and answers a JSON
+ * array with one upload object (`{"url"}`, or `{"errors"}` for a rejected
+ * file) per part, in part order. A server that answers anything else doesn't
+ * support batches; the files are then handed back through
+ * `batchUnsupported()` to be uploaded one by one.
+ *
+ * Files are sent as they are, so `uploadEncrypt` uploads don't use batches.
+ * Retries, endpoint choice and circuit breaking work as for single uploads.
+ * Must live on the `UploadNetwork` thread.
+ */
+class PrivateUploaderBatchUpload : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct File
+    {
+        QString filePath;
+        QString fileName;
+        QString fileType;
+    };
+
+    explicit PrivateUploaderBatchUpload(QNetworkAccessManager* networkAM, QObject* parent = nullptr);
+    ~PrivateUploaderBatchUpload() override;
+
+    void setPriority(UploadPriority priority);
+    void uploadFiles(const QList<File>& files);
+    void cancelUpload();
+
+signals:
+    // speed in Mbps, etaSeconds is -1 while unknown
+    void uploadProgress(int progress, double speed, int etaSeconds);
+    void fileUploaded(FlowinityValidUploadResponse response);
+    void fileFailed(const QString& filePath, const QString& error);
+    void batchUnsupported(const QStringList& filePaths);
+    // Emitted after every file was reported, releases the scheduler slot
+    void uploadFinished();
+
+private:
+    void send();
+    void handleReply(QNetworkReply* reply);
+    void failAll(const QString& error);
+    void finish();
+
+    QNetworkAccessManager* m_NetworkAM;
+    QList<File> m_files;
+    StreamingUploadDevice* m_body = nullptr;
+    QNetworkRequest m_request;
+    QNetworkReply* m_currentReply = nullptr;
+    QString m_endpoint;
+    CircuitBreaker* m_breaker = nullptr;
+    RetryPolicy m_retry;
+    QTimer* m_retryTimer;
+    UploadPriority m_priority = UploadPriority::Bulk;
+    UploadProgressEstimator m_progress;
+};
+
+#endif // PRIVATEUPLOADERBATCHUPLOAD_H
@@ -4,64 +4,68 @@
 
 #include "PrivateUploaderUploadHandler.h"
 
-#include <QTimer>
+#include <QFileInfo>
 
-#include "../../utils/abstractlogger.h"
+#include "../ApiEndpointPool.h"
+#include "../UploadNetwork.h"
+#include "../UploadScheduler.h"
+#include "../UploadSource.h"
 
-PrivateUploaderUploadHandler::PrivateUploaderUploadHandler(QNetworkAccessManager* networkAM, QObject* parent)
+PrivateUploaderUploadHandler::PrivateUploaderUploadHandler(QObject* parent)
     : QObject(parent),
-      m_thread(new QThread(this)),
-      m_worker(new PrivateUploaderUploadV2())
+      m_worker(new PrivateUploaderUploadV2(UploadNetwork::instance()->networkAccessManager()))
 {
-    m_worker->moveToThread(m_thread);
-
-    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
-    connect(this, &PrivateUploaderUploadHandler::destroyed, m_thread, &QThread::quit);
+    m_worker->moveToThread(UploadNetwork::instance()->thread());
 
     connect(m_worker, &PrivateUploaderUploadV2::uploadProgress, this, &PrivateUploaderUploadHandler::uploadProgress);
-
-    connect(m_worker, &PrivateUploaderUploadV2::uploadOk, this, [this](FlowinityValidUploadResponse response)
-    {
-        emit uploadOk(std::move(response));
-
-        // Quit the thread from the main thread
-        m_thread->quit();
-    }, Qt::QueuedConnection);
-
+    connect(m_worker, &PrivateUploaderUploadV2::uploadOk, this, &PrivateUploaderUploadHandler::uploadOk, Qt::QueuedConnection);
     connect(m_worker, &PrivateUploaderUploadV2::uploadError, this, &PrivateUploaderUploadHandler::uploadError, Qt::QueuedConnection);
-
-    m_thread->start();
 }
 
 PrivateUploaderUploadHandler::~PrivateUploaderUploadHandler()
 {
-    if (m_thread->isRunning()) {
-        m_thread->quit();
-        if (!m_thread->wait(3000)) {
-            AbstractLogger::warning() << "Thread did not quit in time, terminating";
-            m_thread->terminate();
-            m_thread->wait();
-        }
-    }
+    // The worker belongs to the network thread, let it clean up there. Its
+    // destructor aborts any reply that is still running.
+    m_worker->deleteLater();
+}
+
+void PrivateUploaderUploadHandler::setPriority(UploadPriority priority)
+{
+    m_priority = priority;
 }
 
 void PrivateUploaderUploadHandler::uploadFile(const QString& filePath, const QString& fileName, const QString& fileType)
 {
-    QMetaObject::invokeMethod(m_worker, [=]() {
-        m_worker->uploadFile(filePath, fileName, fileType);
-    }, Qt::QueuedConnection);
+    UploadScheduler::instance()->submit(m_worker, [worker = m_worker, priority = m_priority, filePath, fileName, fileType]() {
+        worker->setPriority(priority);
+        worker->uploadFile(filePath, fileName, fileType);
+    }, m_priority, QFileInfo(filePath).size(), QUrl(ApiEndpointPool::instance()->preferred()));
 }
 
 void PrivateUploaderUploadHandler::uploadBytes(const QByteArray& data, const QString& fileName, const QString& fileType)
 {
-    QMetaObject::invokeMethod(m_worker, [=]() {
-        m_worker->uploadBytes(data, fileName, fileType);
-    }, Qt::QueuedConnection);
+    UploadScheduler::instance()->submit(m_worker, [worker = m_worker, priority = m_priority, data, fileName, fileType]() {
+        worker->setPriority(priority);
+        worker->uploadBytes(data, fileName, fileType);
+    }, m_priority, data.size(), QUrl(ApiEndpointPool::instance()->preferred()));
+}
+
+void PrivateUploaderUploadHandler::uploadSource(const QSharedPointer<UploadSource>& source,
+                                                const QString& filePath,
+                                                const QString& fileName,
+                                                const QString& fileType)
+{
+    UploadScheduler::instance()->submit(m_worker, [worker = m_worker, priority = m_priority, source, filePath, fileName, fileType]() {
+        worker->setPriority(priority);
+        worker->uploadSource(source, filePath, fileName, fileType);
+    }, m_priority, source->size(), QUrl(ApiEndpointPool::instance()->preferred()));
 }
 
 void PrivateUploaderUploadHandler::cancel()
 {
-    QMetaObject::invokeMethod(m_worker, [=]() {
-        m_worker->cancelUpload();
+    // Reaches the worker right away, even while the network thread is busy hashing
+    m_worker->requestCancel();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker]() {
+        worker->cancelUpload();
     }, Qt::QueuedConnection);
 }
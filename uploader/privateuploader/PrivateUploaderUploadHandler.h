@@ -5,30 +5,37 @@
 #ifndef PRIVATEUPLOADERUPLOADHANDLER_H
 #define PRIVATEUPLOADERUPLOADHANDLER_H
 #include <QObject>
-#include <QThread>
 #include "PrivateUploaderUploadV2.h"
+#include "../UploadPriority.h"
 
 class PrivateUploaderUploadHandler : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit PrivateUploaderUploadHandler(QNetworkAccessManager* networkAM, QObject* parent = nullptr);
+    explicit PrivateUploaderUploadHandler(QObject* parent = nullptr);
     ~PrivateUploaderUploadHandler();
 
+    void setPriority(UploadPriority priority);
+
 public slots:
     void uploadFile(const QString& filePath, const QString& fileName, const QString& fileType);
     void uploadBytes(const QByteArray& data, const QString& fileName, const QString& fileType);
+    void uploadSource(const QSharedPointer<UploadSource>& source,
+                      const QString& filePath,
+                      const QString& fileName,
+                      const QString& fileType);
     void cancel();
 
     signals:
-        void uploadProgress(int progress, double speed);
+        void uploadProgress(int progress, double speed, int etaSeconds);
     void uploadOk(FlowinityValidUploadResponse response);
     void uploadError(QNetworkReply* reply);
 
 private:
-    QThread* m_thread;
+    // Lives on the shared UploadNetwork thread
     PrivateUploaderUploadV2* m_worker;
+    UploadPriority m_priority = UploadPriority::Bulk;
 };
 
 #endif //PRIVATEUPLOADERUPLOADHANDLER_H
@@ -6,9 +6,16 @@
 #include "../../utils/abstractlogger.h"
 #include "../../utils/rng.h"
 #include "../../utils/ConfigHandler.h"
-#include <QBuffer>
+#include "../ApiEndpointPool.h"
+#include "../CircuitBreaker.h"
+#include "../EncryptingSource.h"
+#include "../StreamingUploadDevice.h"
+#include "../UploadCompressor.h"
+#include "../UploadDedupCache.h"
+#include "../UploadNetwork.h"
+#include "../UploadSource.h"
+#include "ResumableUpload.h"
 #include <QFile>
-#include <QHttpPart>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkRequest>
@@ -17,11 +24,20 @@
 
 #include "responses/FlowinityValidUploadResponse.h"
 
-PrivateUploaderUploadV2::PrivateUploaderUploadV2(QObject* parent)
+// Smaller payloads are hashed before upload so a hit skips the network
+// entirely, larger ones are hashed on the fly while uploading, or after it
+// when a resumable session reads them out of order
+static constexpr qint64 DEDUP_PREHASH_LIMIT = 64 * 1024 * 1024;
+
+PrivateUploaderUploadV2::PrivateUploaderUploadV2(QNetworkAccessManager* networkAM, QObject* parent)
   : QObject(parent)
-  , m_NetworkAM(new QNetworkAccessManager(this))
+  , m_NetworkAM(networkAM)
   , m_currentReply(nullptr)
-{}
+  , m_retryTimer(new QTimer(this))
+{
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &PrivateUploaderUploadV2::sendMultipart);
+}
 
 PrivateUploaderUploadV2::~PrivateUploaderUploadV2()
 {
@@ -30,94 +46,389 @@ PrivateUploaderUploadV2::~PrivateUploaderUploadV2()
 
 void PrivateUploaderUploadV2::cancelUpload()
 {
+    ++m_attempt;
+    m_retryTimer->stop();
     if (m_currentReply) {
+        // Don't report the abort as an upload error
+        m_currentReply->disconnect(this);
         m_currentReply->abort();
         m_currentReply->deleteLater();
         m_currentReply = nullptr;
     }
+    if (m_body) {
+        m_body->deleteLater();
+        m_body = nullptr;
+    }
+    if (m_resumable) {
+        m_resumable->abort();
+        m_resumable->deleteLater();
+        m_resumable = nullptr;
+    }
+    // Stops a queued or running compression and deletes its temporary file
+    m_compression.cancel();
+    m_compression = {};
+    m_hashing.cancel();
+    m_hashing = {};
+    m_hashingSource.reset();
+    m_unhashedSource.reset();
+}
+
+void PrivateUploaderUploadV2::requestCancel()
+{
+    m_cancelled = true;
+}
+
+void PrivateUploaderUploadV2::setPriority(UploadPriority priority)
+{
+    m_priority = priority;
 }
 
 void PrivateUploaderUploadV2::uploadBytes(const QByteArray& byteArray, const QString& fileName, const QString& fileType)
 {
-    QByteArray boundary = ("BoUnDaRy-" + Flowshot::randomString(16)).toUtf8();
-    QByteArray postData;
+    m_filePath.clear();
+    dispatchUpload(QSharedPointer<UploadSource>(new ByteArraySource(byteArray)), fileName, fileType, {});
+}
+
+void PrivateUploaderUploadV2::uploadFile(const QString& filePath, const QString& fileName, const QString& fileType)
+{
+    QSharedPointer<UploadSource> source = openFileSource(filePath);
+    if (source.isNull()) {
+        AbstractLogger::error() << "Failed to open file: " << filePath;
+        emit uploadFinished();
+        return;
+    }
 
-    postData.append("--" + boundary + "\r\n");
-    postData.append(R"(Content-Disposition: form-data; name="attachment"; filename=")" + fileName.toUtf8() + "\"\r\n");
-    postData.append("Content-Type: " + fileType.toUtf8() + "\r\n");
-    postData.append("\r\n");
-    postData.append(byteArray);
-    postData.append("\r\n");
-    postData.append("--" + boundary + "--\r\n");
+    uploadSource(source, filePath, fileName, fileType);
+}
 
-    QBuffer* buffer = new QBuffer();
-    buffer->setData(postData);
+void PrivateUploaderUploadV2::uploadSource(const QSharedPointer<UploadSource>& source,
+                                           const QString& filePath,
+                                           const QString& fileName,
+                                           const QString& fileType)
+{
+    m_filePath = filePath;
+    dispatchUpload(source, fileName, fileType, filePath.isEmpty() ? QByteArray() : fileFingerprint(filePath));
+}
 
-    QString url = QStringLiteral("%1/gallery").arg(ConfigHandler().serverAPIEndpoint());
-    QString token = QStringLiteral("%1").arg(ConfigHandler().uploadTokenTPU());
+void PrivateUploaderUploadV2::dispatchUpload(QSharedPointer<UploadSource> source,
+                                             const QString& fileName,
+                                             const QString& fileType,
+                                             const QByteArray& fingerprint)
+{
+    if (m_cancelled) {
+        return;
+    }
+    m_uploadClock.start();
+    m_contentHash.clear();
+    m_dedupScope.clear();
+    m_fingerprint = fingerprint;
+    m_hashingSource.reset();
+    m_unhashedSource.reset();
+    m_encryptionKey.clear();
+
+    ConfigHandler config;
+    // Encrypted uploads get a fresh key each time, there's nothing to reuse
+    if (!config.uploadDedupEnabled() || config.uploadEncrypt()) {
+        startUpload(source, fileName, fileType);
+        return;
+    }
 
-    // uploadToServer(buffer, TODO, TODO, postData.size(), url, token, boundary);
+    // A URL is only reused for the server and account it was uploaded to
+    m_dedupScope = UploadDedupCache::scope(
+      { QStringLiteral("privateuploader"), config.serverAPIEndpoint(), config.serverTPU(), config.uploadTokenTPU() });
+    if (!fingerprint.isEmpty()) {
+        m_contentHash = UploadDedupCache::instance()->hashForFingerprint(fingerprint);
+    }
+    if (m_contentHash.isEmpty() && source->size() <= DEDUP_PREHASH_LIMIT) {
+        // On the pool, reading the file here would stall every upload on the network thread
+        quint64 attempt = ++m_attempt;
+        m_hashing = UploadDedupCache::hashSourceAsync(source, this, [this, attempt, source, fileName, fileType](
+                                                                      QByteArray contentHash) {
+            if (attempt != m_attempt) {
+                return;
+            }
+            m_hashing = {};
+            m_contentHash = contentHash;
+            reuseOrUpload(source, fileName, fileType);
+        });
+        return;
+    }
+    reuseOrUpload(source, fileName, fileType);
 }
 
-void PrivateUploaderUploadV2::uploadFile(const QString& filePath, const QString& fileName, const QString& fileType)
+/**
+ * @brief Hand out the cached URL of the content if there is one, upload it
+ * otherwise. Content without a hash yet is hashed while it uploads.
+ */
+void PrivateUploaderUploadV2::reuseOrUpload(QSharedPointer<UploadSource> source,
+                                            const QString& fileName,
+                                            const QString& fileType)
 {
-    QFile* file = new QFile(filePath);
-    if (!file->open(QIODevice::ReadOnly)) {
-        delete file;
+    if (m_cancelled) {
         return;
     }
 
-    m_filePath = filePath;
+    ConfigHandler config;
+    QString cachedUrl =
+      UploadDedupCache::instance()->lookup(m_dedupScope, m_contentHash, qint64(config.uploadDedupTTL()) * 3600);
+    if (!cachedUrl.isEmpty()) {
+        if (config.uploadDedupValidate()) {
+            validateCachedUpload(cachedUrl, source, fileName, fileType);
+        } else {
+            finishFromCache(cachedUrl);
+        }
+        return;
+    }
+
+    if (m_contentHash.isEmpty()) {
+        m_unhashedSource = source;
+        // Resumable sessions read chunks out of order and skip what the
+        // server has, the digest would have gaps
+        if (!goesResumable(*source)) {
+            m_hashingSource = QSharedPointer<HashingSource>::create(source, UploadDedupCache::HashAlgorithm);
+            source = m_hashingSource;
+        }
+    }
+    startUpload(source, fileName, fileType);
+}
+
+// Whether startUpload() sends `source` through a resumable session
+bool PrivateUploaderUploadV2::goesResumable(const UploadSource& source) const
+{
+    qint64 threshold = qint64(ConfigHandler().uploadResumableThreshold()) * 1024 * 1024;
+    return !m_filePath.isEmpty() && threshold > 0 && source.size() >= threshold;
+}
 
-    QHttpMultiPart* multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-    QHttpPart filePart;
-    filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                       QVariant("form-data; name=\"attachment\"; filename=\"" + fileName + "\""));
-    filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant(fileType));
-    filePart.setBodyDevice(file);
-    file->setParent(multiPart);  // multiPart will delete the file
-    multiPart->append(filePart);
+void PrivateUploaderUploadV2::startUpload(const QSharedPointer<UploadSource>& source,
+                                          const QString& fileName,
+                                          const QString& fileType)
+{
+    if (m_cancelled) {
+        return;
+    }
+    if (ConfigHandler().uploadEncrypt()) {
+        // A resumed session would continue under a different key, and
+        // ciphertext doesn't compress
+        auto encrypted = QSharedPointer<EncryptingSource>::create(source);
+        m_encryptionKey = encrypted->key();
+        postMultipart(encrypted, fileName, QStringLiteral("application/octet-stream"));
+        return;
+    }
+
+    if (goesResumable(*source)) {
+        uploadResumable(source, fileName, fileType);
+        return;
+    }
+    if (ConfigHandler().uploadCompression() && UploadCompressor::worthCompressing(fileType, *source)) {
+        compressAndPost(source, fileName, fileType);
+        return;
+    }
+    postMultipart(source, fileName, fileType);
+}
+
+/**
+ * @brief Make sure a cached URL still resolves before handing it out, and
+ * upload normally if it doesn't.
+ */
+void PrivateUploaderUploadV2::validateCachedUpload(const QString& url,
+                                                   const QSharedPointer<UploadSource>& source,
+                                                   const QString& fileName,
+                                                   const QString& fileType)
+{
+    m_currentReply = m_NetworkAM->head(QNetworkRequest(QUrl(url)));
+
+    connect(m_currentReply, &QNetworkReply::finished, this, [this, url, source, fileName, fileType]() {
+        QNetworkReply* reply = m_currentReply;
+        m_currentReply = nullptr;
+        reply->deleteLater();
+
+        if (reply->error() == QNetworkReply::NoError) {
+            finishFromCache(url);
+            return;
+        }
+        AbstractLogger::info() << QStringLiteral("Cached upload %1 is gone, uploading again").arg(url);
+        UploadDedupCache::instance()->remove(m_dedupScope, m_contentHash);
+        startUpload(source, fileName, fileType);
+    });
+}
+
+void PrivateUploaderUploadV2::finishFromCache(const QString& url)
+{
+    AbstractLogger::info() << QStringLiteral("Content already uploaded, reusing %1").arg(url);
+    emit uploadProgress(100, 0, 0);
+    emit uploadOk(FlowinityValidUploadResponse(url, m_filePath));
+    emit uploadFinished();
+}
+
+void PrivateUploaderUploadV2::postMultipart(const QSharedPointer<UploadSource>& source,
+                                            const QString& fileName,
+                                            const QString& fileType)
+{
+    QByteArray boundary = ("BoUnDaRy-" + Flowshot::randomString(16)).toUtf8();
+
+    m_body = new StreamingUploadDevice(this);
+    m_body->appendFormDataPart(boundary, QStringLiteral("attachment"), fileName, fileType, source);
+    m_body->appendClosingBoundary(boundary);
+    postBody(boundary, {});
+}
+
+/**
+ * @brief Post the multipart body gzipped as a whole, or as it is if it
+ * doesn't compress well after all.
+ */
+void PrivateUploaderUploadV2::compressAndPost(const QSharedPointer<UploadSource>& source,
+                                              const QString& fileName,
+                                              const QString& fileType)
+{
+    QByteArray boundary = ("BoUnDaRy-" + Flowshot::randomString(16)).toUtf8();
+    QByteArray header =
+      StreamingUploadDevice::formDataHeader(boundary, QStringLiteral("attachment"), fileName, fileType);
+    QByteArray trailer = "\r\n" + StreamingUploadDevice::closingBoundary(boundary);
+
+    QList<QSharedPointer<UploadSource>> parts = { QSharedPointer<UploadSource>(new ByteArraySource(header)),
+                                                  source,
+                                                  QSharedPointer<UploadSource>(new ByteArraySource(trailer)) };
+    quint64 attempt = ++m_attempt;
+    m_compression = UploadCompressor::compress(parts, this, [this, attempt, source, fileName, fileType, boundary](
+                                                             QSharedPointer<UploadSource> compressed) {
+        // Cancelled or suspended meanwhile
+        if (attempt != m_attempt) {
+            return;
+        }
+        m_compression = {};
+        if (!compressed) {
+            postMultipart(source, fileName, fileType);
+            return;
+        }
+        m_body = new StreamingUploadDevice(this);
+        m_body->appendSource(compressed);
+        postBody(boundary, QByteArrayLiteral("gzip"));
+    });
+}
+
+void PrivateUploaderUploadV2::postBody(const QByteArray& boundary, const QByteArray& contentEncoding)
+{
+    m_body->setPriority(m_priority);
+    m_body->open(QIODevice::ReadOnly);
 
-    QString url = QStringLiteral("%1/gallery").arg(ConfigHandler().serverAPIEndpoint());
     QString token = QStringLiteral("%1").arg(ConfigHandler().uploadTokenTPU());
 
-    QNetworkRequest request{ QUrl(url) };
-    request.setRawHeader("Authorization", token.toUtf8());
+    // The URL is chosen per attempt in sendMultipart
+    m_request = QNetworkRequest();
+    m_request.setRawHeader("Authorization", token.toUtf8());
+    m_request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("multipart/form-data; boundary=" + boundary));
+    m_request.setHeader(QNetworkRequest::ContentLengthHeader, m_body->size());
+    if (!contentEncoding.isEmpty()) {
+        m_request.setRawHeader("Content-Encoding", contentEncoding);
+    }
+
+    m_retry = RetryPolicy(ConfigHandler().uploadMaxRetries());
+    m_progress.reset();
+    sendMultipart();
+}
+
+void PrivateUploaderUploadV2::sendMultipart()
+{
+    // A retry may go to another node, which fails over from a bad one
+    m_endpoint = ApiEndpointPool::instance()->pick();
+    m_request.setUrl(QUrl(QStringLiteral("%1/gallery").arg(m_endpoint)));
+    m_breaker = CircuitBreaker::forEndpoint(m_request.url());
+
+    qint64 wait = m_breaker->acquire();
+    if (wait > 0) {
+        m_retryTimer->start(int(wait));
+        return;
+    }
 
-    m_currentReply = m_NetworkAM->post(request, multiPart);
-    multiPart->setParent(m_currentReply);  // reply deletes the multiPart
+    m_body->reset();
+    m_currentReply = m_NetworkAM->post(m_request, m_body);
+    // Connected first, so the timings are complete in the finished handler
+    m_timings = UploadTimings::track(m_currentReply);
 
     connect(m_currentReply, &QNetworkReply::finished, this, [this]() {
         QNetworkReply* reply = m_currentReply;
         m_currentReply = nullptr;
+        reply->deleteLater();
+
+        if (reply->error() == QNetworkReply::NoError) {
+            m_timings->timeToUrl = m_uploadClock.elapsed();
+        }
+        AbstractLogger::info() << QStringLiteral("Upload timings %1").arg(m_timings->summary());
+        UploadTimingLog::instance()->record(*m_timings);
+
         if (reply->error() == QNetworkReply::NoError) {
+            m_breaker->recordSuccess();
+            ApiEndpointPool::instance()->recordSuccess(m_endpoint);
             handleReply(reply);
         } else {
+            RetryPolicy::ErrorClass errorClass = RetryPolicy::classify(reply);
+            if (RetryPolicy::isRetryable(errorClass)) {
+                m_breaker->recordFailure();
+                if (errorClass != RetryPolicy::ErrorClass::RateLimited) {
+                    ApiEndpointPool::instance()->recordFailure(m_endpoint);
+                }
+            } else if (errorClass == RetryPolicy::ErrorClass::Permanent &&
+                       reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+                // The API answered, it is up
+                m_breaker->recordSuccess();
+            }
+
+            qint64 delay = m_retry.nextDelay(reply);
+            if (delay >= 0) {
+                AbstractLogger::warning() << QStringLiteral("Upload failed (%1), retry %2 in %3 ms")
+                                               .arg(reply->errorString())
+                                               .arg(m_retry.retries())
+                                               .arg(delay);
+                m_retryTimer->start(int(delay));
+                return;
+            }
             emit uploadError(reply);
         }
-        reply->deleteLater();
+
+        m_body->deleteLater();
+        m_body = nullptr;
+        emit uploadFinished();
     });
 
-    connect(m_currentReply, &QNetworkReply::uploadProgress, this,
-        [this](qint64 bytesSent, qint64 bytesTotal) {
-            if (bytesTotal == 0) return;
-
-             // Calculate progress percentage
-             int progress = static_cast<int>((bytesSent * 100) / bytesTotal);
-
-             qint64 deltaBytes = bytesSent - m_lastBytesSent;
-             qint64 elapsedMs = m_lastTime.elapsed();
-             if (elapsedMs > 0) {
-                 double mbps = (deltaBytes * 8.0 / 1'000'000) / (elapsedMs / 1000.0);
-                 emit uploadProgress(progress, mbps);
-             } else
-             {
-                 emit uploadProgress(progress, 0);
-             }
-
-             m_lastBytesSent = bytesSent;
-             m_lastTime.restart();
-        });
+    connect(m_currentReply, &QNetworkReply::uploadProgress, this, &PrivateUploaderUploadV2::reportProgress);
+}
+
+void PrivateUploaderUploadV2::uploadResumable(const QSharedPointer<UploadSource>& source,
+                                              const QString& fileName,
+                                              const QString& fileType)
+{
+    m_resumable = new ResumableUpload(m_NetworkAM, source, fileName, fileType, this);
+    m_resumable->setSessionKey(ResumableUpload::sessionKeyForFile(m_filePath));
+    m_resumable->setPriority(m_priority);
+    m_progress.reset();
+    m_timings.reset();
+
+    connect(m_resumable, &ResumableUpload::progress, this, &PrivateUploaderUploadV2::reportProgress);
+
+    connect(m_resumable, &ResumableUpload::finished, this, [this](QNetworkReply* reply) {
+        m_resumable->deleteLater();
+        m_resumable = nullptr;
+        handleReply(reply);
+        emit uploadFinished();
+    });
+
+    connect(m_resumable, &ResumableUpload::failed, this, [this](QNetworkReply* reply) {
+        m_resumable->deleteLater();
+        m_resumable = nullptr;
+        emit uploadError(reply);
+        emit uploadFinished();
+    });
+
+    m_resumable->start();
+}
+
+void PrivateUploaderUploadV2::reportProgress(qint64 bytesSent, qint64 bytesTotal)
+{
+    // Callbacks arrive far more often than anyone can read, send a few a second
+    if (!m_progress.update(bytesSent, bytesTotal)) {
+        return;
+    }
+    emit uploadProgress(m_progress.percent(), m_progress.megabitsPerSecond(), m_progress.etaSeconds());
 }
 
 void PrivateUploaderUploadV2::handleReply(QNetworkReply* reply)
@@ -126,7 +437,36 @@ void PrivateUploaderUploadV2::handleReply(QNetworkReply* reply)
         QJsonDocument response = QJsonDocument::fromJson(reply->readAll());
         QJsonObject json = response.object();
         QString url = json[QStringLiteral("url")].toString();
+        if (!m_encryptionKey.isEmpty()) {
+            // The fragment never reaches the server
+            url += QStringLiteral("#key=") +
+                   QString::fromLatin1(m_encryptionKey.toBase64(QByteArray::Base64UrlEncoding |
+                                                                QByteArray::OmitTrailingEquals));
+        }
+
+        QByteArray contentHash = m_contentHash;
+        if (contentHash.isEmpty() && m_hashingSource) {
+            contentHash = m_hashingSource->result();
+        }
+        if (contentHash.isEmpty() && m_unhashedSource) {
+            // Not read through in order, hash it on the pool. The network
+            // thread's object outlives this worker.
+            UploadDedupCache::hashSourceAsync(
+              m_unhashedSource,
+              UploadNetwork::instance(),
+              [scope = m_dedupScope, url, fingerprint = m_fingerprint](QByteArray hash) {
+                  UploadDedupCache::instance()->insert(scope, hash, url, fingerprint);
+              });
+        } else {
+            UploadDedupCache::instance()->insert(m_dedupScope, contentHash, url, m_fingerprint);
+        }
+        m_hashingSource.reset();
+        m_unhashedSource.reset();
+
         FlowinityValidUploadResponse flowinityResponse = FlowinityValidUploadResponse(url, m_filePath);
+        if (m_timings) {
+            flowinityResponse.setTimings(*m_timings);
+        }
         emit uploadOk(flowinityResponse);
     } else {
         emit uploadError(reply);
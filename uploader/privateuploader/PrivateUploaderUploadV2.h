@@ -10,36 +10,117 @@
 #include <QFile>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QElapsedTimer>
+#include <QFuture>
+#include <QSharedPointer>
+#include <QTimer>
+#include <atomic>
 
 #include "responses/FlowinityValidUploadResponse.h"
+#include "../RetryPolicy.h"
+#include "../UploadPriority.h"
+#include "../UploadProgressEstimator.h"
+#include "../UploadTimings.h"
 
+class CircuitBreaker;
+class HashingSource;
+class ResumableUpload;
 class StreamingUploadDevice;
+class UploadSource;
 
 class PrivateUploaderUploadV2 : public QObject
 {
     Q_OBJECT
 
 public:
-    PrivateUploaderUploadV2(QObject* parent = nullptr);
+    explicit PrivateUploaderUploadV2(QNetworkAccessManager* networkAM, QObject* parent = nullptr);
     ~PrivateUploaderUploadV2();
 
+    void setPriority(UploadPriority priority);
     void uploadBytes(const QByteArray& byteArray, const QString& fileName, const QString& fileType);
     void uploadFile(const QString& filePath, const QString& fileName, const QString& fileType);
+    // An already opened source, e.g. shared with mirrors; `filePath` may be empty
+    void uploadSource(const QSharedPointer<UploadSource>& source,
+                      const QString& filePath,
+                      const QString& fileName,
+                      const QString& fileType);
     void handleReply(QNetworkReply* reply);
+    // Stops the current attempt, the scheduler may start the upload again
     void cancelUpload();
+    /**
+     * @brief Give up on the upload for good. Safe to call from any thread,
+     * so that nothing new is started from results already on their way;
+     * follow up with cancelUpload() on the worker's thread.
+     */
+    void requestCancel();
 
     signals:
-        void uploadProgress(int progress, double speed);
+        // speed in Mbps, etaSeconds is -1 while unknown
+        void uploadProgress(int progress, double speed, int etaSeconds);
         void uploadOk(FlowinityValidUploadResponse response);
         void uploadError(QNetworkReply* reply);
+        // Emitted after uploadOk/uploadError, releases the scheduler slot
+        void uploadFinished();
 
 private:
+    void dispatchUpload(QSharedPointer<UploadSource> source,
+                        const QString& fileName,
+                        const QString& fileType,
+                        const QByteArray& fingerprint);
+    void reuseOrUpload(QSharedPointer<UploadSource> source, const QString& fileName, const QString& fileType);
+    void startUpload(const QSharedPointer<UploadSource>& source,
+                     const QString& fileName,
+                     const QString& fileType);
+    bool goesResumable(const UploadSource& source) const;
+    void validateCachedUpload(const QString& url,
+                              const QSharedPointer<UploadSource>& source,
+                              const QString& fileName,
+                              const QString& fileType);
+    void finishFromCache(const QString& url);
+    void postMultipart(const QSharedPointer<UploadSource>& source,
+                       const QString& fileName,
+                       const QString& fileType);
+    void compressAndPost(const QSharedPointer<UploadSource>& source,
+                         const QString& fileName,
+                         const QString& fileType);
+    void postBody(const QByteArray& boundary, const QByteArray& contentEncoding);
+    void sendMultipart();
+    void uploadResumable(const QSharedPointer<UploadSource>& source,
+                         const QString& fileName,
+                         const QString& fileType);
+    void reportProgress(qint64 bytesSent, qint64 bytesTotal);
+
     QNetworkAccessManager* m_NetworkAM;
     QNetworkReply* m_currentReply;
+    // Kept across retries so a retry doesn't re-read or re-encode anything
+    StreamingUploadDevice* m_body = nullptr;
+    QNetworkRequest m_request;
+    QString m_endpoint;
+    RetryPolicy m_retry;
+    CircuitBreaker* m_breaker = nullptr;
+    QTimer* m_retryTimer;
+    ResumableUpload* m_resumable = nullptr;
     QString m_filePath;
-    qint64 m_lastBytesSent = 0;
-    QElapsedTimer m_lastTime;
+    UploadPriority m_priority = UploadPriority::Bulk;
+    // Dedup state of the current upload
+    QByteArray m_dedupScope;
+    QByteArray m_contentHash;
+    QByteArray m_fingerprint;
+    QFuture<QByteArray> m_hashing;
+    QSharedPointer<HashingSource> m_hashingSource;
+    // Content uploaded without a hash, hashed afterwards if reading it along didn't cover it
+    QSharedPointer<UploadSource> m_unhashedSource;
+    QFuture<QSharedPointer<UploadSource>> m_compression;
+    // Key of an encrypted upload, goes into the URL fragment
+    QByteArray m_encryptionKey;
+    UploadProgressEstimator m_progress;
+    QSharedPointer<UploadTimings> m_timings;
+    // Since the upload was handed to us, for the time to URL
+    QElapsedTimer m_uploadClock;
+    // Bumped on cancel, so late results of a cancelled step are ignored
+    quint64 m_attempt = 0;
+    std::atomic_bool m_cancelled{ false };
 };
 
 #endif // PRIVATEUPLOADERUPLOAD_H
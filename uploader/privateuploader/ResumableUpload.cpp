@@ -0,0 +1,470 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "ResumableUpload.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSettings>
+#include <QTimer>
+
+#include "../ApiEndpointPool.h"
+#include "../CircuitBreaker.h"
+#include "../StreamingUploadDevice.h"
+#include "../UploadSource.h"
+#include "../../utils/ConfigHandler.h"
+#include "../../utils/abstractlogger.h"
+
+static constexpr int RESUMABLE_MAX_RECONNECTS = 10;
+static constexpr int RESUMABLE_MAX_BACKOFF_MS = 30000;
+// A chunk that makes no progress for this long is treated as a dropped link
+static constexpr int RESUMABLE_TRANSFER_TIMEOUT_MS = 60000;
+// QNetworkAccessManager opens at most six HTTP/1.1 connections per host
+static constexpr int RESUMABLE_MAX_STREAMS = 6;
+static constexpr int RESUMABLE_TUNE_INTERVAL_MS = 2000;
+
+static QSettings sessionSettings()
+{
+    return QSettings(QSettings::IniFormat,
+                     QSettings::UserScope,
+                     qApp->organizationName(),
+                     QStringLiteral("uploadsessions"));
+}
+
+ResumableUpload::ResumableUpload(QNetworkAccessManager* networkAM,
+                                 QSharedPointer<UploadSource> source,
+                                 const QString& fileName,
+                                 const QString& fileType,
+                                 QObject* parent)
+  : QObject(parent)
+  , m_NetworkAM(networkAM)
+  , m_source(std::move(source))
+  , m_fileName(fileName)
+  , m_fileType(fileType)
+  , m_endpoint(ApiEndpointPool::instance()->pick())
+  , m_token(ConfigHandler().uploadTokenTPU())
+  , m_chunkSizer(qint64(ConfigHandler().uploadChunkSize()) * 1024,
+                qint64(ConfigHandler().uploadChunkSizeMin()) * 1024,
+                qint64(ConfigHandler().uploadChunkSizeMax()) * 1024)
+  , m_retry(RESUMABLE_MAX_RECONNECTS, 1000, RESUMABLE_MAX_BACKOFF_MS)
+  , m_breaker(CircuitBreaker::forEndpoint(QUrl(m_endpoint)))
+  , m_reconnectTimer(new QTimer(this))
+{
+    setStreams(ConfigHandler().uploadParallelStreams());
+    m_clock.start();
+
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, [this]() {
+        if (qint64 wait = m_breaker->acquire(); wait > 0) {
+            m_reconnectTimer->start(int(wait));
+            return;
+        }
+        if (m_sessionId.isEmpty()) {
+            createSession();
+        } else {
+            queryOffset();
+        }
+    });
+}
+
+ResumableUpload::~ResumableUpload()
+{
+    abort();
+}
+
+void ResumableUpload::setChunkSize(qint64 chunkSize)
+{
+    m_chunkSizer = ChunkSizeController(chunkSize, chunkSize, chunkSize);
+}
+
+void ResumableUpload::setStreams(int streams)
+{
+    m_autoStreams = streams <= 0;
+    m_streams = m_autoStreams ? 2 : qMin(streams, RESUMABLE_MAX_STREAMS);
+    // Parallel chunks are read out of order, dropping the pages behind one
+    // would evict the chunk another stream is still sending
+    m_source->setReleaseBehind(!m_autoStreams && m_streams == 1);
+}
+
+void ResumableUpload::setSessionKey(const QString& key)
+{
+    m_sessionKey = key;
+}
+
+void ResumableUpload::setPriority(UploadPriority priority)
+{
+    m_priority = priority;
+}
+
+/**
+ * @brief Key identifying one version of a file, so a changed file never
+ * resumes a stale session.
+ */
+QString ResumableUpload::sessionKeyForFile(const QString& filePath)
+{
+    return QString::fromLatin1(fileFingerprint(filePath).toHex());
+}
+
+void ResumableUpload::start()
+{
+    if (!m_sessionKey.isEmpty()) {
+        QSettings settings = sessionSettings();
+        m_sessionId = settings.value(m_sessionKey).toString();
+        // The session only exists on the node that created it
+        QString endpoint = settings.value(m_sessionKey + QStringLiteral("-endpoint")).toString();
+        if (!m_sessionId.isEmpty() && !endpoint.isEmpty() && endpoint != m_endpoint) {
+            m_endpoint = endpoint;
+            m_breaker = CircuitBreaker::forEndpoint(QUrl(m_endpoint));
+        }
+    }
+
+    if (m_sessionId.isEmpty()) {
+        createSession();
+    } else {
+        AbstractLogger::info() << QStringLiteral("Resuming upload session %1").arg(m_sessionId);
+        queryOffset();
+    }
+}
+
+void ResumableUpload::abort()
+{
+    m_reconnectTimer->stop();
+    if (m_currentReply) {
+        m_currentReply->disconnect(this);
+        m_currentReply->abort();
+        m_currentReply->deleteLater();
+        m_currentReply = nullptr;
+    }
+    abortChunks();
+}
+
+void ResumableUpload::abortChunks()
+{
+    const QList<QNetworkReply*> replies = m_inFlight.keys();
+    m_inFlight.clear();
+    for (QNetworkReply* reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+QNetworkRequest ResumableUpload::request(const QString& path) const
+{
+    QNetworkRequest request{ QUrl(m_endpoint + path) };
+    request.setRawHeader("Authorization", m_token.toUtf8());
+    request.setTransferTimeout(RESUMABLE_TRANSFER_TIMEOUT_MS);
+    return request;
+}
+
+void ResumableUpload::track(QNetworkReply* reply)
+{
+    m_currentReply = reply;
+    // Control requests carry next to no body, their duration is one round trip
+    connect(reply, &QNetworkReply::finished, this, [this, reply, startedAt = m_clock.elapsed()]() {
+        if (reply->error() == QNetworkReply::NoError) {
+            m_chunkSizer.recordRoundTrip(m_clock.elapsed() - startedAt);
+        }
+    });
+}
+
+void ResumableUpload::createSession()
+{
+    QJsonObject session;
+    session.insert(QStringLiteral("name"), m_fileName);
+    session.insert(QStringLiteral("type"), m_fileType);
+    session.insert(QStringLiteral("size"), m_source->size());
+
+    QNetworkRequest request = this->request(QStringLiteral("/gallery/sessions"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("application/json"));
+
+    QNetworkReply* reply = m_NetworkAM->post(request, QJsonDocument(session).toJson(QJsonDocument::Compact));
+    track(reply);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        m_currentReply = nullptr;
+        if (reply->error() != QNetworkReply::NoError) {
+            RetryPolicy::isRetryable(RetryPolicy::classify(reply)) ? reconnect(reply) : fail(reply);
+            return;
+        }
+
+        m_sessionId = QJsonDocument::fromJson(reply->readAll()).object().value(QStringLiteral("id")).toString();
+        if (m_sessionId.isEmpty()) {
+            AbstractLogger::error() << "Upload session response is missing 'id'";
+            fail(reply);
+            return;
+        }
+
+        storeSession();
+        m_retry.reset();
+        m_breaker->recordSuccess();
+        ApiEndpointPool::instance()->recordSuccess(m_endpoint);
+        restartFrom(0);
+    });
+}
+
+void ResumableUpload::queryOffset()
+{
+    QNetworkReply* reply = m_NetworkAM->head(request(QStringLiteral("/gallery/sessions/") + m_sessionId));
+    track(reply);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        m_currentReply = nullptr;
+
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 404 || status == 410) {
+            AbstractLogger::warning() << QStringLiteral("Upload session %1 expired, starting over").arg(m_sessionId);
+            forgetSession();
+            m_sessionId.clear();
+            createSession();
+            return;
+        }
+        if (reply->error() != QNetworkReply::NoError) {
+            RetryPolicy::isRetryable(RetryPolicy::classify(reply)) ? reconnect(reply) : fail(reply);
+            return;
+        }
+
+        qint64 offset = qBound<qint64>(0, reply->rawHeader("Upload-Offset").toLongLong(), m_source->size());
+        m_retry.reset();
+        m_breaker->recordSuccess();
+        ApiEndpointPool::instance()->recordSuccess(m_endpoint);
+        AbstractLogger::info() << QStringLiteral("Server has committed %1 of %2 bytes")
+                                    .arg(offset)
+                                    .arg(m_source->size());
+        restartFrom(offset);
+    });
+}
+
+/**
+ * @brief Forget local chunk state and continue from a server-committed offset.
+ */
+void ResumableUpload::restartFrom(qint64 offset)
+{
+    abortChunks();
+    m_committed.clear();
+    m_committedBytes = 0;
+    m_offset = offset;
+    m_nextOffset = offset;
+    emit progress(m_offset, m_source->size());
+    fillStreams();
+}
+
+void ResumableUpload::fillStreams()
+{
+    const qint64 total = m_source->size();
+    while (m_inFlight.size() < m_streams && m_nextOffset < total) {
+        qint64 length = qMin(m_chunkSizer.chunkSize(), total - m_nextOffset);
+        sendChunk(m_nextOffset, length);
+        m_nextOffset += length;
+    }
+
+    if (!m_inFlight.isEmpty()) {
+        return;
+    }
+    if (m_offset >= total) {
+        complete();
+    } else if (m_nextOffset >= total) {
+        // Every chunk was acknowledged but the server reports a gap, resync
+        queryOffset();
+    }
+}
+
+void ResumableUpload::sendChunk(qint64 start, qint64 length)
+{
+    const qint64 total = m_source->size();
+
+    auto* body = new StreamingUploadDevice();
+    body->setPriority(m_priority);
+    body->appendSource(m_source, start, length);
+    body->open(QIODevice::ReadOnly);
+
+    QNetworkRequest request = this->request(QStringLiteral("/gallery/sessions/") + m_sessionId);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("application/octet-stream"));
+    request.setHeader(QNetworkRequest::ContentLengthHeader, length);
+    request.setRawHeader("Content-Range",
+                         QStringLiteral("bytes %1-%2/%3")
+                           .arg(start)
+                           .arg(start + length - 1)
+                           .arg(total)
+                           .toUtf8());
+    if (m_streams > 1 || m_autoStreams) {
+        // HTTP/2 would multiplex every stream onto one TCP connection
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+    }
+
+    QNetworkReply* reply = m_NetworkAM->put(request, body);
+    body->setParent(reply);
+    m_inFlight.insert(reply, { start, length, 0, m_clock.elapsed(), -1 });
+    if (!m_tuneTimer.isValid()) {
+        m_tuneTimer.start();
+    }
+
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, reply, total](qint64 chunkSent, qint64) {
+        auto it = m_inFlight.find(reply);
+        if (it != m_inFlight.end()) {
+            it->sent = chunkSent;
+            if (chunkSent >= it->length && it->sentAt < 0) {
+                it->sentAt = m_clock.elapsed();
+            }
+            emit progress(bytesSent(), total);
+        }
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        Chunk chunk = m_inFlight.take(reply);
+        if (reply->error() != QNetworkReply::NoError) {
+            if (RetryPolicy::isRetryable(RetryPolicy::classify(reply))) {
+                m_chunkSizer.recordFailure();
+                abortChunks();
+                reconnect(reply);
+            } else {
+                abort();
+                fail(reply);
+            }
+            return;
+        }
+
+        bool ok = false;
+        qint64 serverOffset = reply->rawHeader("Upload-Offset").toLongLong(&ok);
+        m_retry.reset();
+        m_breaker->recordSuccess();
+        ApiEndpointPool::instance()->recordSuccess(m_endpoint);
+        qint64 now = m_clock.elapsed();
+        qint64 sentAt = chunk.sentAt < 0 ? now : chunk.sentAt;
+        m_chunkSizer.recordChunk(chunk.length, sentAt - chunk.startedAt, now - sentAt);
+        commitChunk(chunk, ok ? serverOffset : -1);
+        emit progress(bytesSent(), m_source->size());
+        tuneStreams(chunk.length);
+        fillStreams();
+    });
+}
+
+void ResumableUpload::commitChunk(const Chunk& chunk, qint64 serverOffset)
+{
+    m_committed.insert(chunk.start, chunk.start + chunk.length);
+    m_committedBytes += chunk.length;
+
+    if (serverOffset > m_offset) {
+        m_offset = qMin(serverOffset, m_source->size());
+    }
+
+    // Advance the contiguous prefix over committed chunks
+    while (!m_committed.isEmpty() && m_committed.firstKey() <= m_offset) {
+        auto first = m_committed.begin();
+        m_committedBytes -= first.value() - first.key();
+        m_offset = qMax(m_offset, first.value());
+        m_committed.erase(first);
+    }
+    m_nextOffset = qMax(m_nextOffset, m_offset);
+}
+
+qint64 ResumableUpload::bytesSent() const
+{
+    qint64 sent = m_offset + m_committedBytes;
+    for (const Chunk& chunk : m_inFlight) {
+        sent += chunk.sent;
+    }
+    return qMin(sent, m_source->size());
+}
+
+/**
+ * @brief Hill-climb the number of parallel streams: add one while the
+ * aggregate throughput keeps improving, drop one when it falls off.
+ */
+void ResumableUpload::tuneStreams(qint64 committedBytes)
+{
+    if (!m_autoStreams) {
+        return;
+    }
+    m_tuneBytes += committedBytes;
+    qint64 elapsed = m_tuneTimer.elapsed();
+    if (elapsed < RESUMABLE_TUNE_INTERVAL_MS) {
+        return;
+    }
+
+    double throughput = m_tuneBytes * 1000.0 / elapsed;
+    int streams = m_streams;
+    if (m_lastThroughput == 0 || throughput > m_lastThroughput * 1.1) {
+        streams = qMin(m_streams + 1, RESUMABLE_MAX_STREAMS);
+    } else if (throughput < m_lastThroughput * 0.9) {
+        streams = qMax(m_streams - 1, 1);
+    }
+
+    if (streams != m_streams) {
+        AbstractLogger::info() << QStringLiteral("Parallel upload: %1 MB/s over %2 streams, switching to %3")
+                                    .arg(throughput / 1'000'000, 0, 'f', 1)
+                                    .arg(m_streams)
+                                    .arg(streams);
+        m_streams = streams;
+    }
+    m_lastThroughput = throughput;
+    m_tuneBytes = 0;
+    m_tuneTimer.restart();
+}
+
+void ResumableUpload::complete()
+{
+    QNetworkRequest request = this->request(QStringLiteral("/gallery/sessions/%1/complete").arg(m_sessionId));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("application/json"));
+
+    QNetworkReply* reply = m_NetworkAM->post(request, QByteArray());
+    track(reply);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        m_currentReply = nullptr;
+        if (reply->error() != QNetworkReply::NoError) {
+            RetryPolicy::isRetryable(RetryPolicy::classify(reply)) ? reconnect(reply) : fail(reply);
+            return;
+        }
+        forgetSession();
+        emit finished(reply);
+    });
+}
+
+void ResumableUpload::reconnect(QNetworkReply* reply)
+{
+    qint64 delay = m_retry.nextDelay(reply);
+    if (delay < 0) {
+        fail(reply);
+        return;
+    }
+    m_breaker->recordFailure();
+    ApiEndpointPool::instance()->recordFailure(m_endpoint);
+
+    AbstractLogger::warning() << QStringLiteral("Upload interrupted (%1), resuming in %2 ms")
+                                   .arg(reply->errorString())
+                                   .arg(delay);
+    m_reconnectTimer->start(int(delay));
+}
+
+void ResumableUpload::fail(QNetworkReply* reply)
+{
+    AbstractLogger::error() << QStringLiteral("Resumable upload failed: %1").arg(reply->errorString());
+    emit failed(reply);
+}
+
+void ResumableUpload::storeSession()
+{
+    if (!m_sessionKey.isEmpty()) {
+        QSettings settings = sessionSettings();
+        settings.setValue(m_sessionKey, m_sessionId);
+        settings.setValue(m_sessionKey + QStringLiteral("-endpoint"), m_endpoint);
+    }
+}
+
+void ResumableUpload::forgetSession()
+{
+    if (!m_sessionKey.isEmpty()) {
+        QSettings settings = sessionSettings();
+        settings.remove(m_sessionKey);
+        settings.remove(m_sessionKey + QStringLiteral("-endpoint"));
+    }
+}
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef RESUMABLEUPLOAD_H
+#define RESUMABLEUPLOAD_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+
+#include "../ChunkSizeController.h"
+#include "../RetryPolicy.h"
+#include "../UploadPriority.h"
+
+class CircuitBreaker;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
+class QTimer;
+class UploadSource;
+
+/**
+ * @brief Uploads a source in offset-addressed chunks through an upload
+ * session, resuming from the server's committed offset after a failure.
+ *
+ * Protocol, relative to the API endpoint:
+ * - `POST /gallery/sessions` with `{"name", "type", "size"}` creates a session
+ *   and answers `{"id"}`.
+ * - `PUT /gallery/sessions/{id}` with `Content-Range: bytes a-b/size` stores
+ *   one chunk. The response carries `Upload-Offset`, the number of contiguous
+ *   bytes the server has committed.
+ * - `HEAD /gallery/sessions/{id}` answers the committed `Upload-Offset`, or
+ *   404 once the session has expired.
+ * - `POST /gallery/sessions/{id}/complete` assembles the file and answers the
+ *   regular upload response (`{"url"}`).
+ *
+ * Several chunks can be in flight at once, each over its own connection, so a
+ * single large file is not capped by one TCP window on high-latency links.
+ * The stream count is fixed or hill-climbed on measured throughput, the chunk
+ * size follows the round-trip time and goodput of the chunks sent so far
+ * (see ChunkSizeController).
+ *
+ * Everything is driven by reply signals, there is no nested event loop. When
+ * a session key is set, the session id is persisted so that a later process
+ * uploading the same file resumes the same session.
+ */
+class ResumableUpload : public QObject
+{
+    Q_OBJECT
+
+public:
+    ResumableUpload(QNetworkAccessManager* networkAM,
+                    QSharedPointer<UploadSource> source,
+                    const QString& fileName,
+                    const QString& fileType,
+                    QObject* parent = nullptr);
+    ~ResumableUpload() override;
+
+    // Fixes the chunk size, it adapts within the configured bounds otherwise
+    void setChunkSize(qint64 chunkSize);
+    // 0 tunes the stream count automatically
+    void setStreams(int streams);
+    void setSessionKey(const QString& key);
+    void setPriority(UploadPriority priority);
+
+    void start();
+    void abort();
+
+    static QString sessionKeyForFile(const QString& filePath);
+
+signals:
+    void progress(qint64 bytesSent, qint64 bytesTotal);
+    // The reply is deleted after the signal returns
+    void finished(QNetworkReply* reply);
+    void failed(QNetworkReply* reply);
+
+private:
+    struct Chunk
+    {
+        qint64 start;
+        qint64 length;
+        qint64 sent;
+        // On m_clock, sentAt is -1 until the last byte was handed over
+        qint64 startedAt;
+        qint64 sentAt;
+    };
+
+    QNetworkRequest request(const QString& path) const;
+    void track(QNetworkReply* reply);
+
+    void createSession();
+    void queryOffset();
+    void fillStreams();
+    void sendChunk(qint64 start, qint64 length);
+    void commitChunk(const Chunk& chunk, qint64 serverOffset);
+    void restartFrom(qint64 offset);
+    void abortChunks();
+    void tuneStreams(qint64 committedBytes);
+    qint64 bytesSent() const;
+    void complete();
+    void reconnect(QNetworkReply* reply);
+    void fail(QNetworkReply* reply);
+
+    void storeSession();
+    void forgetSession();
+
+    QNetworkAccessManager* m_NetworkAM;
+    QSharedPointer<UploadSource> m_source;
+    QString m_fileName;
+    QString m_fileType;
+    QString m_endpoint;
+    QString m_token;
+    QString m_sessionKey;
+    QString m_sessionId;
+    UploadPriority m_priority = UploadPriority::Bulk;
+    // Contiguous bytes committed from the start of the file
+    qint64 m_offset = 0;
+    // Next byte not yet assigned to a chunk
+    qint64 m_nextOffset = 0;
+    ChunkSizeController m_chunkSizer;
+    QElapsedTimer m_clock;
+    RetryPolicy m_retry;
+    CircuitBreaker* m_breaker;
+    // Session, offset and completion requests
+    QPointer<QNetworkReply> m_currentReply;
+    QTimer* m_reconnectTimer;
+
+    QHash<QNetworkReply*, Chunk> m_inFlight;
+    // Committed chunks past m_offset, start -> end
+    QMap<qint64, qint64> m_committed;
+    qint64 m_committedBytes = 0;
+
+    int m_streams = 1;
+    bool m_autoStreams = false;
+    QElapsedTimer m_tuneTimer;
+    qint64 m_tuneBytes = 0;
+    double m_lastThroughput = 0;
+};
+
+#endif // RESUMABLEUPLOAD_H
@@ -20,7 +20,6 @@
 #include <iostream>
 #include <QFileInfo>
 #include <utility>
-#include <QImageReader>
 #include <QMimeDatabase>
 
 #include "PrivateUploaderUploadHandler.h"
@@ -34,17 +33,31 @@ using namespace Flowshot;
     PrivateUploader::PrivateUploader(const QPixmap& capture, QWidget* parent, bool fromScreenshotUtility)
       : ImgUploaderBase(capture, parent)
     {
-        m_NetworkAM = new QNetworkAccessManager(this);
         m_fromScreenshotUtility = fromScreenshotUtility;
     }
 
     PrivateUploader::PrivateUploader(const QString& filePath, QWidget* parent, bool fromScreenshotUtility)
   : ImgUploaderBase(filePath, parent)
     {
-        m_NetworkAM = new QNetworkAccessManager(this);
         m_fromScreenshotUtility = fromScreenshotUtility;
     }
 
+    PrivateUploader::~PrivateUploader()
+    {
+        cancelUpload();
+    }
+
+    void PrivateUploader::cancelUpload()
+    {
+        if (m_handler)
+        {
+            m_handler->cancel();
+            // The worker goes with it, which frees its scheduler slot
+            m_handler->deleteLater();
+            m_handler = nullptr;
+        }
+    }
+
     void PrivateUploader::handleReply(FlowinityValidUploadResponse response)
     {
         m_currentImageName = response.getUrl();
@@ -53,24 +66,9 @@ using namespace Flowshot;
             m_currentImageName = m_currentImageName.mid(lastSlash + 1);
         }
 
-        setImageURL(response.getUrl());
         setFilePath(response.getFilePath());
-        if (m_fromScreenshotUtility && ConfigHandler().uploadWindowImageEnabled())
-        {
-            QImageReader reader(response.getFilePath());
-            reader.setAutoTransform(true);
-            QSize originalSize = reader.size();
-            QSize scaledSize = originalSize;
-            scaledSize.scale(QSize(512, 512), Qt::KeepAspectRatio);
-            reader.setScaledSize(scaledSize);
-
-            QImage img = reader.read();
-            if (!img.isNull()) {
-                QPixmap pixmap = QPixmap::fromImage(img);
-                setPixmap(pixmap);
-            }
-        }
-        emit uploadOk(response.getUrl());
+        // The preview comes from ScreenshotManager, decoded while uploading
+        reportUrl(response.getUrl());
 
         // Create shortcut on the main thread - use 'this' as parent to ensure proper thread affinity
         QShortcut* shortcut = new QShortcut(Qt::Key_Escape, this);
@@ -79,7 +77,7 @@ using namespace Flowshot;
 
     void PrivateUploader::upload()
     {
-        bool useByteArray = m_fromScreenshotUtility && !pixmap().isNull();
+        bool useByteArray = m_fromScreenshotUtility && !pixmap().isNull() && source().isNull();
         QByteArray byteArray;
         QBuffer buffer(&byteArray);
         if (useByteArray)
@@ -89,13 +87,28 @@ using namespace Flowshot;
 
         // if (Experiments::FLOWSHOT2_USE_NEW_UPLOAD_BACKEND == 1)
         {
-            PrivateUploaderUploadHandler* uploader = new PrivateUploaderUploadHandler(m_NetworkAM, nullptr);
+            // A retry starts over
+            cancelUpload();
+            PrivateUploaderUploadHandler* uploader = new PrivateUploaderUploadHandler(nullptr);
+            m_handler = uploader;
+            // Captures are waited on, they go ahead of file uploads
+            uploader->setPriority(m_fromScreenshotUtility ? UploadPriority::Interactive
+                                                          : UploadPriority::Bulk);
             connect(uploader,
                     &PrivateUploaderUploadHandler::uploadOk,
+                    this,
                     [this, uploader](FlowinityValidUploadResponse response) {
                         handleReply(std::move(response));
                         uploader->deleteLater();
                     });
+            // The reply is gone by the time this arrives, don't read it
+            connect(uploader,
+                    &PrivateUploaderUploadHandler::uploadError,
+                    this,
+                    [this, uploader]() {
+                        uploader->deleteLater();
+                        showUploadErrorMessage(tr("Error uploading file"));
+                    });
             QString fileName = nullptr;
             if (m_fromScreenshotUtility)
             {
@@ -107,7 +120,10 @@ using namespace Flowshot;
             }
             QMimeDatabase db;
             QMimeType mime = db.mimeTypeForFile(filePath());
-            if (!filePath().isNull()) {
+            if (!source().isNull()) {
+                uploader->uploadSource(source(), filePath(), fileName,
+                                       filePath().isNull() ? QStringLiteral("image/png") : mime.name());
+            } else if (!filePath().isNull()) {
                 uploader->uploadFile(filePath(), fileName, mime.name());
             } else if (useByteArray)
             {
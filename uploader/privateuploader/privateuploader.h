@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../imguploaderbase.h"
+#include <QPointer>
 #include <QUrl>
 #include <QWidget>
 
@@ -12,6 +13,7 @@
 class QNetworkReply;
 class QNetworkAccessManager;
 class QUrl;
+class PrivateUploaderUploadHandler;
 
 using namespace Flowshot;
 
@@ -21,6 +23,7 @@ class PrivateUploader : public ImgUploaderBase
 public:
     explicit PrivateUploader(const QPixmap& capture, QWidget* parent = nullptr, bool fromScreenshotUtility = false);
     explicit PrivateUploader(const QString& filePath, QWidget* parent = nullptr, bool fromScreenshotUtility = false);
+    ~PrivateUploader() override;
 
     void deleteImage(const QString& fileName, const QString& deleteToken);
     void uploadBytes(const QByteArray& bytes);
@@ -29,8 +32,12 @@ public:
 public slots:
     void handleReply(FlowinityValidUploadResponse reply);
 
+protected:
+    void cancelUpload() override;
+
 private:
-    QNetworkAccessManager* m_NetworkAM;
     bool m_fromScreenshotUtility;
+    // The running upload, deleting it aborts the transfer
+    QPointer<PrivateUploaderUploadHandler> m_handler;
     void upload();
 };
\ No newline at end of file
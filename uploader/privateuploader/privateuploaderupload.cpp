@@ -2,9 +2,8 @@
 // SPDX-FileCopyrightText: 2023 Troplo & Contributors
 
 #include "privateuploaderupload.h"
-#include "../../utils/flowinity/EndpointsJSON.h"
+#include "../../utils/flowinity/EndpointsCache.h"
 #include <QDesktopServices>
-#include <QEventLoop>
 #include <QFile>
 #include <QHttpPart>
 #include <QJsonDocument>
@@ -18,6 +17,8 @@
 #include <iostream>
 #include "../../utils/abstractlogger.h"
 #include "../../utils/rng.h"
+#include "../UploadSource.h"
+#include "ResumableUpload.h"
 
 PrivateUploaderUpload::PrivateUploaderUpload(QObject* parent)
   : QObject(parent)
@@ -66,8 +67,8 @@ void PrivateUploaderUpload::uploadToServer(const QByteArray& postData, const QSt
             AbstractLogger::info() << "Upload completed.";
             emit uploadOk(reply);
         } else {
-            EndpointsJSON* endpoints = new EndpointsJSON(this);
-            endpoints->getAPIFromEndpoints(true);
+            // Shared and rate limited, an outage doesn't multiply discovery requests
+            EndpointsCache::instance()->fetch(true);
             emit uploadError(reply);
         }
 
@@ -81,66 +82,35 @@ void PrivateUploaderUpload::uploadToServer(const QByteArray& postData, const QSt
     });
 }
 
-void PrivateUploaderUpload::uploadFile(const QString& filePath, const QString& fileName, const QString& fileType, const QByteArray& boundary)
+void PrivateUploaderUpload::uploadFile(const QString& filePath, const QString& fileName, const QString& fileType)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
+    QSharedPointer<UploadSource> source = openFileSource(filePath);
+    if (source.isNull()) {
         AbstractLogger::error() << "Failed to open file: " << filePath.toUtf8().constData();
         return;
     }
 
-    QString url = QStringLiteral("%1/gallery").arg(ConfigHandler().serverAPIEndpoint());
-    QString token = QStringLiteral("%1").arg(ConfigHandler().uploadTokenTPU());
-
-    QNetworkRequest request;
-    request.setUrl(QUrl(url));
-    request.setRawHeader("Authorization", token.toUtf8());
-    request.setRawHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
-
-    QByteArray headerData = QString("--" + boundary + "\r\n" +
-                                    "Content-Disposition: form-data; name=\"attachment\"; filename=\"" +
-                                    fileName.toUtf8() + "\"\r\n" +
-                                    "Content-Type: " + fileType.toUtf8() + "\r\n" +
-                                    "\r\n").toUtf8();
-
-    QByteArray footerData = QString("\r\n--" + boundary + "--\r\n").toUtf8();
-
-    qint64 fileSize = file.size();
-    qint64 bytesUploaded = 0;
-    qint64 chunkSize = 4096 * 4096;
-
-    QNetworkAccessManager manager;
-    QNetworkReply* reply = nullptr;
-
-    while (bytesUploaded < fileSize) {
-        QByteArray postData;
-        postData.append(headerData);
-
-        qint64 bytesToRead = qMin(chunkSize, fileSize - bytesUploaded);
-        QByteArray chunk = file.read(bytesToRead);
-        postData.append(chunk);
+    // Offset-addressed chunks through an upload session, so an interrupted
+    // upload resumes from the committed offset instead of starting over
+    auto* upload = new ResumableUpload(m_NetworkAM, source, fileName, fileType, this);
+    upload->setSessionKey(ResumableUpload::sessionKeyForFile(filePath));
 
-        if (bytesUploaded + bytesToRead == fileSize) {
-            postData.append(footerData);
-        }
-
-        reply = manager.post(request, postData);
-        QEventLoop loop;
-        QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-        loop.exec();
+    connect(upload, &ResumableUpload::progress, this, [this](qint64 bytesSent, qint64 bytesTotal) {
+        if (bytesTotal == 0)
+            return;
+        emit uploadProgress(bytesSent * 100 / bytesTotal, 0);
+    });
 
-        if (reply->error() != QNetworkReply::NoError) {
-            // Handle error
-            qDebug() << "Error occurred during upload:" << reply->errorString();
-            break;
-        } else {
-            qDebug() << "Upload successful!";
-        }
+    connect(upload, &ResumableUpload::finished, this, [this, upload](QNetworkReply* reply) {
+        AbstractLogger::info() << "Upload completed.";
+        emit uploadOk(reply);
+        upload->deleteLater();
+    });
 
-        bytesUploaded += bytesToRead;
-    }
+    connect(upload, &ResumableUpload::failed, this, [this, upload](QNetworkReply* reply) {
+        emit uploadError(reply);
+        upload->deleteLater();
+    });
 
-    if (reply) {
-        reply->deleteLater();
-    }
+    upload->start();
 }
@@ -29,8 +29,7 @@ public slots:
                         const QByteArray& boundary);
     void uploadFile(const QString& filePath,
                     const QString& fileName,
-                    const QString& fileType,
-                    const QByteArray& boundary);
+                    const QString& fileType);
 
 signals:
     void uploadOk(QNetworkReply* reply);
@@ -6,12 +6,15 @@
 #define FLOWINITYVALIDUPLOADRESPONSE_H
 #include <QString>
 
+#include "../../UploadTimings.h"
+
 
 class FlowinityValidUploadResponse {
 private:
     QString m_Url;
     QString m_FilePath;
     bool m_showPreview;
+    UploadTimings m_timings;
 public:
     inline FlowinityValidUploadResponse(QString url, QString filePath, bool showPreview = false)
     {
@@ -35,6 +38,17 @@ public:
         return m_showPreview;
     };
 
+    inline void setTimings(const UploadTimings& timings)
+    {
+        m_timings = timings;
+    };
+
+    // Phase timings of the request that produced the URL, if it was timed
+    inline UploadTimings getTimings()
+    {
+        return m_timings;
+    };
+
 };
 
 
@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "S3MultipartUpload.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "../../utils/ConfigHandler.h"
+#include "../../utils/abstractlogger.h"
+#include "../../utils/rng.h"
+#include "../StreamingUploadDevice.h"
+#include "../EncryptingSource.h"
+#include "../UploadSource.h"
+#include "S3Signer.h"
+
+// S3 allows at most this many parts per upload
+static constexpr int S3_MAX_PARTS = 10000;
+// Hex digits of the random directory every object is put under
+static constexpr int S3_KEY_PREFIX_LENGTH = 16;
+
+// Text of the first `element` in an S3 XML response, empty if there is none
+static QString xmlElement(const QByteArray& document, const QString& element)
+{
+    QXmlStreamReader reader(document);
+    while (!reader.atEnd()) {
+        if (reader.readNext() == QXmlStreamReader::StartElement && reader.name() == element) {
+            return reader.readElementText();
+        }
+    }
+    return {};
+}
+
+// The store's own error message if it sent one
+static QString errorMessage(QNetworkReply* reply, const QByteArray& body)
+{
+    QString message = xmlElement(body, QStringLiteral("Message"));
+    return message.isEmpty() ? reply->errorString() : message;
+}
+
+S3MultipartUpload::S3MultipartUpload(QNetworkAccessManager* networkAM, QObject* parent)
+  : QObject(parent)
+  , m_NetworkAM(networkAM)
+  , m_keyPrefix(Flowshot::randomString(S3_KEY_PREFIX_LENGTH))
+{}
+
+S3MultipartUpload::~S3MultipartUpload()
+{
+    cancelUpload();
+}
+
+void S3MultipartUpload::setPriority(UploadPriority priority)
+{
+    m_priority = priority;
+}
+
+void S3MultipartUpload::uploadFile(const QString& filePath, const QString& key, const QString& contentType)
+{
+    // One handle shared by the parts; reads happen on this thread, one at a time
+    auto source = QSharedPointer<FileRegionSource>::create(filePath);
+    if (!source->open()) {
+        fail(QStringLiteral("Failed to open file %1: %2").arg(filePath, source->errorString()));
+        return;
+    }
+    uploadSource(source, key, contentType);
+}
+
+void S3MultipartUpload::uploadBytes(const QByteArray& data, const QString& key, const QString& contentType)
+{
+    uploadSource(QSharedPointer<UploadSource>(new ByteArraySource(data)), key, contentType);
+}
+
+void S3MultipartUpload::cancelUpload()
+{
+    ++m_attempt;
+    if (m_controlReply) {
+        m_controlReply->disconnect(this);
+        m_controlReply->abort();
+        m_controlReply->deleteLater();
+    }
+    for (auto it = m_inFlight.constBegin(); it != m_inFlight.constEnd(); ++it) {
+        // Don't report the abort as a part failure
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    m_inFlight.clear();
+    m_queue.clear();
+    abortUpload();
+}
+
+void S3MultipartUpload::uploadSource(QSharedPointer<UploadSource> source, const QString& key, const QString& contentType)
+{
+    ConfigHandler config;
+    m_endpoint = config.s3Endpoint().trimmed();
+    while (m_endpoint.endsWith(QLatin1Char('/'))) {
+        m_endpoint.chop(1);
+    }
+    m_bucket = config.s3Bucket().trimmed();
+    m_publicUrl = config.s3PublicUrl().trimmed();
+    while (m_publicUrl.endsWith(QLatin1Char('/'))) {
+        m_publicUrl.chop(1);
+    }
+    m_pathStyle = config.s3PathStyle();
+    m_concurrency = config.s3PartConcurrency();
+    m_signer = std::make_unique<S3Signer>(config.s3AccessKey(), config.s3SecretKey(), config.s3Region());
+
+    if (m_endpoint.isEmpty() || m_bucket.isEmpty()) {
+        fail(QStringLiteral("The S3 endpoint and bucket are not configured"));
+        return;
+    }
+
+    m_encryptionKey.clear();
+    if (config.uploadEncrypt()) {
+        // The store only ever sees ciphertext, the key goes into the URL
+        auto encrypted = QSharedPointer<EncryptingSource>::create(std::move(source));
+        m_encryptionKey = encrypted->key();
+        source = encrypted;
+    }
+    m_source = std::move(source);
+    // File names repeat across machines and runs, a PUT to an existing key
+    // would silently replace that object. Chosen once per worker so a
+    // suspended upload comes back to the same key.
+    m_key = m_keyPrefix + QLatin1Char('/') + key;
+    m_contentType = m_encryptionKey.isEmpty() ? contentType : QStringLiteral("application/octet-stream");
+    m_uploadId.clear();
+    m_parts.clear();
+    m_queue.clear();
+    m_done = 0;
+    m_retry = RetryPolicy(config.uploadMaxRetries());
+    m_progress.reset();
+
+    qint64 size = m_source->size();
+    qint64 partSize = qint64(config.s3PartSize()) * 1024 * 1024;
+    // Very large objects get larger parts rather than too many
+    partSize = qMax(partSize, (size + S3_MAX_PARTS - 1) / S3_MAX_PARTS);
+
+    if (size <= partSize) {
+        Part part;
+        part.number = 0;
+        part.offset = 0;
+        part.length = size;
+        part.retry = RetryPolicy(config.uploadMaxRetries());
+        m_parts.append(part);
+        m_queue.append(0);
+        fillParts();
+        return;
+    }
+
+    for (qint64 offset = 0; offset < size; offset += partSize) {
+        Part part;
+        part.number = int(m_parts.size()) + 1;
+        part.offset = offset;
+        part.length = qMin(partSize, size - offset);
+        part.retry = RetryPolicy(config.uploadMaxRetries());
+        m_queue.append(int(m_parts.size()));
+        m_parts.append(part);
+    }
+    // Parts are read side by side, one must not drop the pages of another
+    m_source->setReleaseBehind(m_concurrency <= 1);
+    createUpload();
+}
+
+QUrl S3MultipartUpload::objectUrl(const QString& query) const
+{
+    QByteArray key = S3Signer::uriEncode(m_key, true);
+    QUrl url;
+    if (m_pathStyle) {
+        url = QUrl(m_endpoint + QLatin1Char('/') + S3Signer::uriEncode(m_bucket, false) +
+                   QLatin1Char('/') + QString::fromLatin1(key));
+    } else {
+        url = QUrl(m_endpoint);
+        url.setHost(m_bucket + QLatin1Char('.') + url.host());
+        url.setPath(QLatin1Char('/') + QString::fromLatin1(key), QUrl::StrictMode);
+    }
+    if (!query.isEmpty()) {
+        url.setQuery(query, QUrl::StrictMode);
+    }
+    return url;
+}
+
+QNetworkRequest S3MultipartUpload::request(const QUrl& url, const QByteArray& method) const
+{
+    QNetworkRequest request(url);
+    m_signer->sign(request, method);
+    return request;
+}
+
+void S3MultipartUpload::createUpload()
+{
+    QNetworkRequest request = this->request(objectUrl(QStringLiteral("uploads=")), "POST");
+    request.setHeader(QNetworkRequest::ContentTypeHeader, m_contentType);
+    m_controlReply = m_NetworkAM->post(request, QByteArray());
+
+    connect(m_controlReply, &QNetworkReply::finished, this, [this, reply = m_controlReply.data()]() {
+        reply->deleteLater();
+        QByteArray body = reply->readAll();
+
+        if (reply->error() != QNetworkReply::NoError) {
+            qint64 delay = m_retry.nextDelay(reply);
+            if (delay < 0) {
+                fail(QStringLiteral("Failed to start the S3 upload: %1").arg(errorMessage(reply, body)));
+                return;
+            }
+            QTimer::singleShot(int(delay), this, [this, attempt = m_attempt]() {
+                if (attempt == m_attempt) {
+                    createUpload();
+                }
+            });
+            return;
+        }
+
+        m_uploadId = xmlElement(body, QStringLiteral("UploadId"));
+        if (m_uploadId.isEmpty()) {
+            fail(QStringLiteral("The S3 store didn't return an upload id"));
+            return;
+        }
+        m_retry.reset();
+        fillParts();
+    });
+}
+
+void S3MultipartUpload::fillParts()
+{
+    while (m_inFlight.size() < m_concurrency && !m_queue.isEmpty()) {
+        sendPart(m_queue.takeFirst());
+    }
+}
+
+void S3MultipartUpload::sendPart(int index)
+{
+    Part& part = m_parts[index];
+    part.sent = 0;
+
+    QUrl url = part.number == 0
+                 ? objectUrl()
+                 : objectUrl(QStringLiteral("partNumber=%1&uploadId=%2")
+                               .arg(part.number)
+                               .arg(QString::fromLatin1(S3Signer::uriEncode(m_uploadId, false))));
+    QNetworkRequest request = this->request(url, "PUT");
+    request.setHeader(QNetworkRequest::ContentLengthHeader, part.length);
+    // Parts carry raw bytes, the object's type was set when the upload was created
+    request.setHeader(QNetworkRequest::ContentTypeHeader,
+                      part.number == 0 ? m_contentType : QStringLiteral("application/octet-stream"));
+
+    auto* body = new StreamingUploadDevice();
+    body->appendSource(m_source, part.offset, part.length);
+    body->setPriority(m_priority);
+    body->open(QIODevice::ReadOnly);
+
+    QNetworkReply* reply = m_NetworkAM->put(request, body);
+    // The body lives exactly as long as the request that reads it
+    body->setParent(reply);
+    m_inFlight.insert(reply, index);
+
+    connect(reply, &QNetworkReply::uploadProgress, this, [this, index](qint64 sent, qint64) {
+        m_parts[index].sent = sent;
+        reportProgress();
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, index]() {
+        m_inFlight.remove(reply);
+        reply->deleteLater();
+        Part& part = m_parts[index];
+
+        if (reply->error() != QNetworkReply::NoError) {
+            QByteArray body = reply->readAll();
+            part.sent = 0;
+            qint64 delay = part.retry.nextDelay(reply);
+            if (delay < 0) {
+                fail(QStringLiteral("Failed to upload part %1 to S3: %2")
+                       .arg(part.number)
+                       .arg(errorMessage(reply, body)));
+                return;
+            }
+            AbstractLogger::warning() << QStringLiteral("S3 part %1 failed (%2), retry %3 in %4 ms")
+                                           .arg(part.number)
+                                           .arg(reply->errorString())
+                                           .arg(part.retry.retries())
+                                           .arg(delay);
+            QTimer::singleShot(int(delay), this, [this, index, attempt = m_attempt]() {
+                if (attempt == m_attempt) {
+                    m_queue.prepend(index);
+                    fillParts();
+                }
+            });
+            fillParts();
+            return;
+        }
+
+        part.sent = part.length;
+        part.etag = reply->rawHeader("ETag");
+        ++m_done;
+
+        if (m_done < m_parts.size()) {
+            fillParts();
+            return;
+        }
+        if (part.number == 0) {
+            finish(objectUrl().toString());
+        } else {
+            completeUpload();
+        }
+    });
+}
+
+void S3MultipartUpload::completeUpload()
+{
+    QByteArray document;
+    QXmlStreamWriter writer(&document);
+    writer.writeStartElement(QStringLiteral("CompleteMultipartUpload"));
+    for (const Part& part : std::as_const(m_parts)) {
+        writer.writeStartElement(QStringLiteral("Part"));
+        writer.writeTextElement(QStringLiteral("PartNumber"), QString::number(part.number));
+        writer.writeTextElement(QStringLiteral("ETag"), QString::fromLatin1(part.etag));
+        writer.writeEndElement();
+    }
+    writer.writeEndElement();
+
+    QUrl url = objectUrl(QStringLiteral("uploadId=%1").arg(QString::fromLatin1(S3Signer::uriEncode(m_uploadId, false))));
+    QNetworkRequest request = this->request(url, "POST");
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/xml"));
+    m_controlReply = m_NetworkAM->post(request, document);
+
+    connect(m_controlReply, &QNetworkReply::finished, this, [this, reply = m_controlReply.data()]() {
+        reply->deleteLater();
+        QByteArray body = reply->readAll();
+
+        // The store may answer 200 and still report an error in the body
+        QString error = xmlElement(body, QStringLiteral("Code"));
+        if (reply->error() == QNetworkReply::NoError && error.isEmpty()) {
+            m_uploadId.clear();
+            finish(objectUrl().toString());
+            return;
+        }
+
+        qint64 delay = reply->error() != QNetworkReply::NoError ? m_retry.nextDelay(reply) : -1;
+        if (delay < 0) {
+            fail(QStringLiteral("Failed to complete the S3 upload: %1").arg(errorMessage(reply, body)));
+            return;
+        }
+        QTimer::singleShot(int(delay), this, [this, attempt = m_attempt]() {
+            if (attempt == m_attempt) {
+                completeUpload();
+            }
+        });
+    });
+}
+
+void S3MultipartUpload::abortUpload()
+{
+    if (m_uploadId.isEmpty() || !m_signer) {
+        return;
+    }
+    QUrl url = objectUrl(QStringLiteral("uploadId=%1").arg(QString::fromLatin1(S3Signer::uriEncode(m_uploadId, false))));
+    m_uploadId.clear();
+
+    // Best effort, the store's lifecycle rules clean up whatever this misses
+    QNetworkReply* reply = m_NetworkAM->deleteResource(request(url, "DELETE"));
+    connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+}
+
+void S3MultipartUpload::finish(const QString& url)
+{
+    QString result = url;
+    if (!m_publicUrl.isEmpty()) {
+        result = m_publicUrl + QLatin1Char('/') + QString::fromLatin1(S3Signer::uriEncode(m_key, true));
+    }
+    if (!m_encryptionKey.isEmpty()) {
+        // The fragment never reaches the server
+        result += QStringLiteral("#key=") +
+                  QString::fromLatin1(m_encryptionKey.toBase64(QByteArray::Base64UrlEncoding |
+                                                               QByteArray::OmitTrailingEquals));
+    }
+    m_source.reset();
+    emit uploadOk(result);
+    emit uploadFinished();
+}
+
+void S3MultipartUpload::fail(const QString& message)
+{
+    AbstractLogger::error() << message;
+    // Stop the other parts, they can't complete the object anymore
+    cancelUpload();
+    m_source.reset();
+    emit uploadError(message);
+    emit uploadFinished();
+}
+
+void S3MultipartUpload::reportProgress()
+{
+    qint64 sent = 0;
+    qint64 total = 0;
+    for (const Part& part : std::as_const(m_parts)) {
+        sent += part.sent;
+        total += part.length;
+    }
+    if (!m_progress.update(sent, total)) {
+        return;
+    }
+    emit uploadProgress(m_progress.percent(), m_progress.megabitsPerSecond(), m_progress.etaSeconds());
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef S3MULTIPARTUPLOAD_H
+#define S3MULTIPARTUPLOAD_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QUrl>
+#include <memory>
+
+#include "../RetryPolicy.h"
+#include "../UploadPriority.h"
+#include "../UploadProgressEstimator.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
+class S3Signer;
+class UploadSource;
+
+/**
+ * @brief Uploads one object to an S3-compatible store, splitting it into
+ * parts that are uploaded concurrently.
+ *
+ * Objects up to one part (`s3PartSize`) go up with a single `PUT`. Larger
+ * ones use the multipart API:
+ * - `POST /key?uploads` answers the `UploadId`.
+ * - `PUT /key?partNumber=N&uploadId=…` stores one part and answers its
+ *   `ETag`. Up to `s3PartConcurrency` parts are in flight, each retried on
+ *   its own, so a failed part doesn't restart the others.
+ * - `POST /key?uploadId=…` with the part list assembles the object.
+ *
+ * On failure or cancellation the upload is aborted with
+ * `DELETE /key?uploadId=…`, so the store doesn't keep the parts around.
+ *
+ * With `uploadEncrypt` the object is the `EncryptingSource` ciphertext and the
+ * key is only in the `#key=` fragment of the reported URL, as for Flowinity.
+ *
+ * Every object goes under a random directory, `<16 hex digits>/key`, so
+ * uploads with the same file name don't overwrite each other.
+ *
+ * Parts are read straight from the source, nothing is buffered per part.
+ * Must live on the `UploadNetwork` thread.
+ */
+class S3MultipartUpload : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit S3MultipartUpload(QNetworkAccessManager* networkAM, QObject* parent = nullptr);
+    ~S3MultipartUpload() override;
+
+    void setPriority(UploadPriority priority);
+    void uploadFile(const QString& filePath, const QString& key, const QString& contentType);
+    void uploadBytes(const QByteArray& data, const QString& key, const QString& contentType);
+    // An already opened source, e.g. shared with mirrors
+    void uploadSource(QSharedPointer<UploadSource> source, const QString& key, const QString& contentType);
+    void cancelUpload();
+
+signals:
+    // speed in Mbps, etaSeconds is -1 while unknown
+    void uploadProgress(int progress, double speed, int etaSeconds);
+    void uploadOk(const QString& url);
+    void uploadError(const QString& message);
+    // Emitted after uploadOk/uploadError, releases the scheduler slot
+    void uploadFinished();
+
+private:
+    struct Part
+    {
+        int number; // 0 for a single PUT of the whole object
+        qint64 offset;
+        qint64 length;
+        qint64 sent = 0;
+        QByteArray etag;
+        RetryPolicy retry;
+    };
+
+    QUrl objectUrl(const QString& query = {}) const;
+    QNetworkRequest request(const QUrl& url, const QByteArray& method) const;
+
+    void createUpload();
+    void fillParts();
+    void sendPart(int index);
+    void completeUpload();
+    void abortUpload();
+    void finish(const QString& url);
+    void fail(const QString& message);
+    void reportProgress();
+
+    QNetworkAccessManager* m_NetworkAM;
+    std::unique_ptr<S3Signer> m_signer;
+    QSharedPointer<UploadSource> m_source;
+    QString m_keyPrefix;
+    QString m_key;
+    QString m_contentType;
+    // Key of an encrypted upload, goes into the URL fragment
+    QByteArray m_encryptionKey;
+    QString m_endpoint;
+    QString m_bucket;
+    QString m_publicUrl;
+    bool m_pathStyle = true;
+    int m_concurrency = 1;
+    UploadPriority m_priority = UploadPriority::Bulk;
+
+    QString m_uploadId;
+    QList<Part> m_parts;
+    // Indexes into m_parts waiting for a slot
+    QList<int> m_queue;
+    QHash<QNetworkReply*, int> m_inFlight;
+    int m_done = 0;
+    // Create and complete requests
+    QPointer<QNetworkReply> m_controlReply;
+    RetryPolicy m_retry;
+    // Bumped by cancelUpload, stale retry timers check it
+    quint64 m_attempt = 0;
+    UploadProgressEstimator m_progress;
+};
+
+#endif // S3MULTIPARTUPLOAD_H
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef S3SIGNER_H
+#define S3SIGNER_H
+
+#include <QByteArray>
+#include <QString>
+
+class QNetworkRequest;
+
+/**
+ * @brief AWS Signature Version 4 for S3-compatible object stores.
+ *
+ * Signs the host, `x-amz-content-sha256` and `x-amz-date` headers. Payloads
+ * are sent as `UNSIGNED-PAYLOAD` unless a hash is given, so large parts don't
+ * have to be read twice.
+ */
+class S3Signer
+{
+public:
+    S3Signer(QString accessKey, QString secretKey, QString region);
+
+    void sign(QNetworkRequest& request,
+              const QByteArray& method,
+              const QByteArray& payloadHash = QByteArrayLiteral("UNSIGNED-PAYLOAD")) const;
+
+    // RFC 3986 encoding as SigV4 wants it, '/' kept for paths
+    static QByteArray uriEncode(const QString& value, bool keepSlash);
+
+private:
+    QString m_accessKey;
+    QString m_secretKey;
+    QString m_region;
+};
+
+#endif // S3SIGNER_H
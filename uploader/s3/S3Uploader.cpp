@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "S3Uploader.h"
+
+#include <QBuffer>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QShortcut>
+
+#include "../../utils/filenamehandler.h"
+#include "../UploadNetwork.h"
+#include "../UploadScheduler.h"
+#include "../UploadSource.h"
+#include "S3MultipartUpload.h"
+
+S3Uploader::S3Uploader(const QPixmap& capture, QWidget* parent, bool fromScreenshotUtility)
+  : ImgUploaderBase(capture, parent)
+  , m_fromScreenshotUtility(fromScreenshotUtility)
+{}
+
+S3Uploader::S3Uploader(const QString& filePath, QWidget* parent, bool fromScreenshotUtility)
+  : ImgUploaderBase(filePath, parent)
+  , m_fromScreenshotUtility(fromScreenshotUtility)
+{}
+
+S3Uploader::~S3Uploader()
+{
+    cancelUpload();
+}
+
+void S3Uploader::cancelUpload()
+{
+    // Its destructor aborts the upload, on the thread it belongs to
+    if (m_worker) {
+        m_worker->deleteLater();
+        m_worker = nullptr;
+    }
+}
+
+void S3Uploader::upload()
+{
+    cancelUpload();
+    m_worker = new S3MultipartUpload(UploadNetwork::instance()->networkAccessManager());
+    m_worker->moveToThread(UploadNetwork::instance()->thread());
+    S3MultipartUpload* worker = m_worker;
+
+    connect(worker, &S3MultipartUpload::uploadProgress, this, &S3Uploader::updateProgress, Qt::QueuedConnection);
+    connect(worker, &S3MultipartUpload::uploadOk, this, &S3Uploader::handleReply, Qt::QueuedConnection);
+    connect(worker, &S3MultipartUpload::uploadError, this, &S3Uploader::showUploadErrorMessage, Qt::QueuedConnection);
+    connect(worker, &S3MultipartUpload::uploadFinished, worker, &QObject::deleteLater);
+
+    QString key;
+    if (m_fromScreenshotUtility) {
+        key = FileNameHandler().parsedPattern() + ".png";
+    } else {
+        key = FileNameHandler().parseFilename(QFileInfo(filePath()).fileName());
+    }
+    // Captures are waited on, they go ahead of file uploads
+    UploadPriority priority = m_fromScreenshotUtility ? UploadPriority::Interactive : UploadPriority::Bulk;
+
+    if (!source().isNull()) {
+        QSharedPointer<UploadSource> source = this->source();
+        QString contentType = filePath().isNull() ? QStringLiteral("image/png")
+                                                  : QMimeDatabase().mimeTypeForFile(filePath()).name();
+        UploadScheduler::instance()->submit(worker, [worker, priority, source, key, contentType]() {
+            worker->setPriority(priority);
+            worker->uploadSource(source, key, contentType);
+        }, priority, source->size());
+    } else if (!filePath().isNull()) {
+        QString path = filePath();
+        QString contentType = QMimeDatabase().mimeTypeForFile(path).name();
+        UploadScheduler::instance()->submit(worker, [worker, priority, path, key, contentType]() {
+            worker->setPriority(priority);
+            worker->uploadFile(path, key, contentType);
+        }, priority, QFileInfo(path).size());
+    } else if (!pixmap().isNull()) {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        pixmap().save(&buffer, "PNG");
+        UploadScheduler::instance()->submit(worker, [worker, priority, bytes, key]() {
+            worker->setPriority(priority);
+            worker->uploadBytes(bytes, key, QStringLiteral("image/png"));
+        }, priority, bytes.size());
+    }
+}
+
+void S3Uploader::handleReply(const QString& url)
+{
+    // Without the #key= fragment of an encrypted upload
+    m_currentImageName = QUrl(url).fileName();
+    reportUrl(QUrl(url));
+
+    QShortcut* shortcut = new QShortcut(Qt::Key_Escape, this);
+    connect(shortcut, &QShortcut::activated, this, &S3Uploader::close);
+}
+
+void S3Uploader::deleteImage(const QString& fileName, const QString& deleteToken)
+{
+    Q_UNUSED(fileName)
+    Q_UNUSED(deleteToken)
+}
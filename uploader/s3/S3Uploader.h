@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef S3UPLOADER_H
+#define S3UPLOADER_H
+
+#include <QPointer>
+
+#include "../imguploaderbase.h"
+
+class S3MultipartUpload;
+
+using namespace Flowshot;
+
+/**
+ * @brief Upload window for the "s3" backend: stores captures and files in an
+ * S3-compatible bucket (`s3*` options) through `S3MultipartUpload`.
+ */
+class S3Uploader : public ImgUploaderBase
+{
+    Q_OBJECT
+
+public:
+    explicit S3Uploader(const QPixmap& capture, QWidget* parent = nullptr, bool fromScreenshotUtility = false);
+    explicit S3Uploader(const QString& filePath, QWidget* parent = nullptr, bool fromScreenshotUtility = false);
+    ~S3Uploader() override;
+
+    void deleteImage(const QString& fileName, const QString& deleteToken) override;
+
+protected:
+    void cancelUpload() override;
+
+private:
+    void upload() override;
+    void handleReply(const QString& url);
+
+    bool m_fromScreenshotUtility;
+    // Lives on the shared UploadNetwork thread
+    QPointer<S3MultipartUpload> m_worker;
+};
+
+#endif // S3UPLOADER_H
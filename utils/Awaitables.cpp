@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "Awaitables.h"
+
+#include <QNetworkReply>
+#include <QProcess>
+#include <QTimer>
+
+namespace Flowshot {
+
+namespace detail {
+
+AwaiterContext::~AwaiterContext()
+{
+    // Destroyed while suspended, nothing may resume the coroutine anymore
+    for (const QMetaObject::Connection& connection : std::as_const(m_connections)) {
+        QObject::disconnect(connection);
+    }
+}
+
+QObject* AwaiterContext::object()
+{
+    if (!m_object) {
+        m_object = std::make_unique<QObject>();
+    }
+    return m_object.get();
+}
+
+void AwaiterContext::track(const QMetaObject::Connection& connection)
+{
+    m_connections.append(connection);
+}
+
+void AwaiterContext::resume(std::coroutine_handle<> handle)
+{
+    for (const QMetaObject::Connection& connection : std::as_const(m_connections)) {
+        QObject::disconnect(connection);
+    }
+    m_connections.clear();
+    // This usually runs in a slot of the object, it goes once that returned
+    if (m_object) {
+        m_object.release()->deleteLater();
+    }
+    handle.resume();
+}
+
+} // namespace detail
+
+ReplyAwaiter::ReplyAwaiter(QNetworkReply* reply, int timeoutMs)
+  : m_reply(reply)
+  , m_timeoutMs(timeoutMs)
+{
+}
+
+bool ReplyAwaiter::await_ready() const
+{
+    return m_reply->isFinished();
+}
+
+void ReplyAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_context.track(QObject::connect(m_reply, &QNetworkReply::finished, m_context.object(), [this, handle]() {
+        m_context.resume(handle);
+    }));
+
+    if (m_timeoutMs > 0) {
+        auto* timer = new QTimer(m_context.object());
+        timer->setSingleShot(true);
+        m_context.track(QObject::connect(timer, &QTimer::timeout, m_reply, &QNetworkReply::abort));
+        timer->start(m_timeoutMs);
+    }
+}
+
+ProcessAwaiter::ProcessAwaiter(QProcess* process)
+  : m_process(process)
+{
+}
+
+bool ProcessAwaiter::await_ready() const
+{
+    return m_process->state() == QProcess::NotRunning;
+}
+
+void ProcessAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_context.track(QObject::connect(m_process,
+                                     QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                                     m_context.object(),
+                                     [this, handle]() { m_context.resume(handle); }));
+    // finished() isn't emitted for a process that never ran
+    m_context.track(QObject::connect(m_process, &QProcess::errorOccurred, m_context.object(), [this, handle](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            m_context.resume(handle);
+        }
+    }));
+}
+
+int ProcessAwaiter::await_resume() const
+{
+    if (m_process->error() == QProcess::FailedToStart || m_process->exitStatus() != QProcess::NormalExit) {
+        return -1;
+    }
+    return m_process->exitCode();
+}
+
+} // namespace Flowshot
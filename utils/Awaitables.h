@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef AWAITABLES_H
+#define AWAITABLES_H
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QPromise>
+#include <QThreadPool>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+#include "Task.h"
+
+class QNetworkReply;
+class QProcess;
+
+namespace Flowshot {
+
+namespace detail {
+
+/**
+ * @brief The connections of one suspended `co_await`.
+ *
+ * They are made to a context object created on the awaiting thread, so a
+ * signal from another thread resumes the coroutine on the awaiting one. The
+ * first resume() cuts all of them; destroying the awaiter cuts them too.
+ */
+class AwaiterContext
+{
+public:
+    AwaiterContext() = default;
+    AwaiterContext(AwaiterContext&&) = default;
+    ~AwaiterContext();
+
+    // Created on first use, call it from the awaiting thread
+    QObject* object();
+    void track(const QMetaObject::Connection& connection);
+    void resume(std::coroutine_handle<> handle);
+
+private:
+    std::unique_ptr<QObject> m_object;
+    QList<QMetaObject::Connection> m_connections;
+};
+
+} // namespace detail
+
+/**
+ * @brief Resumes with the arguments of the next emission of a signal, or
+ * with nullopt if the sender is destroyed first.
+ */
+template<typename Sender, typename... Args>
+class SignalAwaiter
+{
+public:
+    using Result = std::optional<std::tuple<std::decay_t<Args>...>>;
+
+    SignalAwaiter(Sender* sender, void (Sender::*signal)(Args...))
+      : m_sender(sender)
+      , m_signal(signal)
+    {
+    }
+
+    bool await_ready() const noexcept { return m_sender.isNull(); }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_context.track(QObject::connect(m_sender.data(), m_signal, m_context.object(), [this, handle](Args... args) {
+            m_result.emplace(args...);
+            m_context.resume(handle);
+        }));
+        m_context.track(QObject::connect(m_sender.data(), &QObject::destroyed, m_context.object(), [this, handle]() {
+            m_context.resume(handle);
+        }));
+    }
+
+    Result await_resume() { return std::move(m_result); }
+
+private:
+    QPointer<Sender> m_sender;
+    void (Sender::*m_signal)(Args...);
+    Result m_result;
+    detail::AwaiterContext m_context;
+};
+
+template<typename Sender, typename Class, typename... Args>
+SignalAwaiter<Class, Args...> awaitSignal(Sender* sender, void (Class::*signal)(Args...))
+{
+    return SignalAwaiter<Class, Args...>(sender, signal);
+}
+
+/**
+ * @brief Resumes with the reply once it finished. A reply still running
+ * after `timeoutMs` (0 = no limit) is aborted, it then finishes with
+ * OperationCanceledError. The reply must belong to the awaiting thread.
+ */
+class ReplyAwaiter
+{
+public:
+    ReplyAwaiter(QNetworkReply* reply, int timeoutMs);
+
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle);
+    QNetworkReply* await_resume() const { return m_reply; }
+
+private:
+    QNetworkReply* m_reply;
+    int m_timeoutMs;
+    detail::AwaiterContext m_context;
+};
+
+inline ReplyAwaiter awaitReply(QNetworkReply* reply, int timeoutMs = 0)
+{
+    return ReplyAwaiter(reply, timeoutMs);
+}
+
+/**
+ * @brief Resumes with the exit code of a started process once it finished,
+ * or -1 if it crashed or couldn't be started.
+ */
+class ProcessAwaiter
+{
+public:
+    explicit ProcessAwaiter(QProcess* process);
+
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle);
+    int await_resume() const;
+
+private:
+    QProcess* m_process;
+    detail::AwaiterContext m_context;
+};
+
+inline ProcessAwaiter awaitProcess(QProcess* process)
+{
+    return ProcessAwaiter(process);
+}
+
+/**
+ * @brief Runs a function on the global thread pool and resumes with its
+ * result on the awaiting thread.
+ */
+template<typename R>
+class PoolAwaiter
+{
+    static_assert(!std::is_void_v<R>, "pool functions return their result");
+
+public:
+    explicit PoolAwaiter(std::function<R()> function)
+      : m_function(std::move(function))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        auto* watcher = new QFutureWatcher<R>(m_context.object());
+        m_context.track(QObject::connect(watcher, &QFutureWatcherBase::finished, m_context.object(), [this, watcher, handle]() {
+            m_result.emplace(watcher->result());
+            m_context.resume(handle);
+        }));
+
+        auto promise = std::make_shared<QPromise<R>>();
+        watcher->setFuture(promise->future());
+        QThreadPool::globalInstance()->start([function = std::move(m_function), promise]() {
+            promise->start();
+            promise->addResult(function());
+            promise->finish();
+        });
+    }
+
+    R await_resume() { return std::move(*m_result); }
+
+private:
+    std::function<R()> m_function;
+    std::optional<R> m_result;
+    detail::AwaiterContext m_context;
+};
+
+/**
+ * @brief Start `function` on the thread pool. The task can be awaited later,
+ * so other work runs meanwhile.
+ */
+template<typename Function>
+Task<std::invoke_result_t<Function>> runInPool(Function function)
+{
+    co_return co_await PoolAwaiter<std::invoke_result_t<Function>>(std::move(function));
+}
+
+} // namespace Flowshot
+
+#endif // AWAITABLES_H
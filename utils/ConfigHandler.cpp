@@ -92,6 +92,8 @@ static QMap<class QString, QSharedPointer<ValueHandler>>
     // Endpoints
     OPTION("serverEndpoints", String("https://flowinity.com/endpoints.json")),
     OPTION("serverAPIEndpoint", String("https://api.flowinity.com/v3")),
+    // Every API node from endpoints.json, space separated
+    OPTION("serverAPIEndpointList", String("")),
     OPTION("serverSupportsEndpoints", Bool(true)),
     OPTION("screenshotUtility", BoundedInt(0, Flowshot::ScreenshotUtilityMax, static_cast<int>(Flowshot::ScreenshotUtility::SPECTACLE))),
     OPTION("copyURLAfterUpload"          ,Bool               ( true          )),
@@ -99,6 +101,66 @@ static QMap<class QString, QSharedPointer<ValueHandler>>
     OPTION("savePathFixed"               ,Bool               ( false         )),
     OPTION("saveAsFileExtension"         ,SaveFileExtension  (               )),
     OPTION("filenamePattern"             ,FilenamePattern    ( {}            )),
+    // Upload pipeline
+    OPTION("uploadMaxConcurrent"         ,LowerBoundedInt    ( 1, 4          )),
+    // MiB, files at least this large use upload sessions (0 = never)
+    OPTION("uploadResumableThreshold"    ,LowerBoundedInt    ( 0, 0          )),
+    // KiB per session chunk at the start, it then follows RTT and goodput
+    OPTION("uploadChunkSize"             ,LowerBoundedInt    ( 64, 8192      )),
+    // KiB, bounds of the adapted chunk size (equal bounds fix it)
+    OPTION("uploadChunkSizeMin"          ,LowerBoundedInt    ( 64, 256       )),
+    OPTION("uploadChunkSizeMax"          ,LowerBoundedInt    ( 64, 65536     )),
+    // Session chunks in flight at once (0 = tune automatically)
+    OPTION("uploadParallelStreams"       ,LowerBoundedInt    ( 0, 1          )),
+    // Order of queued uploads: "sejf" (small and interactive first) or "fifo"
+    OPTION("uploadSchedulingPolicy"      ,String             ( "sejf"        )),
+    // Automatic retries of a failed upload request
+    OPTION("uploadMaxRetries"            ,LowerBoundedInt    ( 0, 5          )),
+    // Seconds between connection refreshes to the API while idle (0 = off)
+    OPTION("uploadKeepWarmInterval"      ,LowerBoundedInt    ( 0, 60         )),
+    // Use HTTP/2 where the server offers it
+    OPTION("uploadHttp2"                 ,Bool               ( true          )),
+    // Uploads in flight when they share one HTTP/2 connection
+    OPTION("uploadHttp2MaxStreams"       ,LowerBoundedInt    ( 1, 16         )),
+    // KiB, HTTP/2 flow-control windows of the connection and of each stream
+    OPTION("uploadHttp2SessionWindow"    ,LowerBoundedInt    ( 64, 16384     )),
+    OPTION("uploadHttp2StreamWindow"     ,LowerBoundedInt    ( 64, 1024      )),
+    // gzip text-like uploads, the server must accept Content-Encoding
+    OPTION("uploadCompression"           ,Bool               ( false         )),
+    // Encrypt uploads with AES-256-GCM, the key goes in the URL fragment
+    OPTION("uploadEncrypt"               ,Bool               ( false         )),
+    // KiB/s for all uploads together (0 = unlimited)
+    OPTION("uploadRateLimit"             ,LowerBoundedInt    ( 0, 0          )),
+    // KiB/s for file and background uploads, captures aren't capped by it
+    OPTION("uploadBulkRateLimit"         ,LowerBoundedInt    ( 0, 0          )),
+    // Return the previous URL when the same content is uploaded again
+    OPTION("uploadDedupEnabled"          ,Bool               ( true          )),
+    // Hours a cached URL stays valid (0 = forever)
+    OPTION("uploadDedupTTL"              ,LowerBoundedInt    ( 0, 168        )),
+    // Check with a HEAD request that a cached URL still exists
+    OPTION("uploadDedupValidate"         ,Bool               ( true          )),
+    // KiB and file count per request when several files are uploaded at once
+    OPTION("uploadBatchMaxSize"          ,LowerBoundedInt    ( 64, 8192      )),
+    OPTION("uploadBatchMaxFiles"         ,LowerBoundedInt    ( 1, 50         )),
+    // Uploader backends
+    // "privateuploader" (Flowinity) or "s3"
+    OPTION("uploaderBackend"             ,String             ( "privateuploader" )),
+    // Backends every upload is also sent to, space separated, e.g. "s3"
+    OPTION("uploadMirrors"               ,String             ( ""            )),
+    // S3-compatible object store, e.g. https://s3.us-east-1.amazonaws.com or a MinIO server
+    OPTION("s3Endpoint"                  ,String             ( ""            )),
+    OPTION("s3Region"                    ,String             ( "us-east-1"   )),
+    OPTION("s3Bucket"                    ,String             ( ""            )),
+    OPTION("s3AccessKey"                 ,String             ( ""            )),
+    OPTION("s3SecretKey"                 ,String             ( ""            )),
+    // endpoint/bucket/key instead of bucket.endpoint/key, MinIO needs this
+    OPTION("s3PathStyle"                 ,Bool               ( true          )),
+    // Base of the returned URL, defaults to the object URL
+    OPTION("s3PublicUrl"                 ,String             ( ""            )),
+    // MiB per multipart part, S3 needs at least 5
+    OPTION("s3PartSize"                  ,LowerBoundedInt    ( 5, 16         )),
+    // Parts uploaded at once
+    OPTION("s3PartConcurrency"           ,LowerBoundedInt    ( 1, 4          )),
 };
 
 // clang-format on
@@ -106,6 +106,9 @@ public:
     // Flowinity Endpoints update (2024)
     CONFIG_GETTER_SETTER(serverEndpoints, setServerEndpoints, QString)
     CONFIG_GETTER_SETTER(serverAPIEndpoint, setServerAPIEndpoint, QString)
+    CONFIG_GETTER_SETTER(serverAPIEndpointList,
+                         setServerAPIEndpointList,
+                         QString)
     CONFIG_GETTER_SETTER(serverSupportsEndpoints,
                          setServerSupportsEndpoints,
                          bool)
@@ -116,6 +119,51 @@ public:
     CONFIG_GETTER_SETTER(savePathFixed, setSavePathFixed, bool)
     CONFIG_GETTER_SETTER(saveAsFileExtension, setSaveAsFileExtension, QString)
     CONFIG_GETTER_SETTER(filenamePattern, setFilenamePattern, QString);
+    // Upload pipeline
+    CONFIG_GETTER_SETTER(uploadMaxConcurrent, setUploadMaxConcurrent, int)
+    CONFIG_GETTER_SETTER(uploadResumableThreshold,
+                         setUploadResumableThreshold,
+                         int)
+    CONFIG_GETTER_SETTER(uploadChunkSize, setUploadChunkSize, int)
+    CONFIG_GETTER_SETTER(uploadChunkSizeMin, setUploadChunkSizeMin, int)
+    CONFIG_GETTER_SETTER(uploadChunkSizeMax, setUploadChunkSizeMax, int)
+    CONFIG_GETTER_SETTER(uploadParallelStreams, setUploadParallelStreams, int)
+    CONFIG_GETTER_SETTER(uploadSchedulingPolicy,
+                         setUploadSchedulingPolicy,
+                         QString)
+    CONFIG_GETTER_SETTER(uploadMaxRetries, setUploadMaxRetries, int)
+    CONFIG_GETTER_SETTER(uploadKeepWarmInterval,
+                         setUploadKeepWarmInterval,
+                         int)
+    CONFIG_GETTER_SETTER(uploadHttp2, setUploadHttp2, bool)
+    CONFIG_GETTER_SETTER(uploadHttp2MaxStreams, setUploadHttp2MaxStreams, int)
+    CONFIG_GETTER_SETTER(uploadHttp2SessionWindow,
+                         setUploadHttp2SessionWindow,
+                         int)
+    CONFIG_GETTER_SETTER(uploadHttp2StreamWindow,
+                         setUploadHttp2StreamWindow,
+                         int)
+    CONFIG_GETTER_SETTER(uploadCompression, setUploadCompression, bool)
+    CONFIG_GETTER_SETTER(uploadEncrypt, setUploadEncrypt, bool)
+    CONFIG_GETTER_SETTER(uploadRateLimit, setUploadRateLimit, int)
+    CONFIG_GETTER_SETTER(uploadBulkRateLimit, setUploadBulkRateLimit, int)
+    CONFIG_GETTER_SETTER(uploadDedupEnabled, setUploadDedupEnabled, bool)
+    CONFIG_GETTER_SETTER(uploadDedupTTL, setUploadDedupTTL, int)
+    CONFIG_GETTER_SETTER(uploadDedupValidate, setUploadDedupValidate, bool)
+    CONFIG_GETTER_SETTER(uploadBatchMaxSize, setUploadBatchMaxSize, int)
+    CONFIG_GETTER_SETTER(uploadBatchMaxFiles, setUploadBatchMaxFiles, int)
+    // Uploader backends
+    CONFIG_GETTER_SETTER(uploaderBackend, setUploaderBackend, QString)
+    CONFIG_GETTER_SETTER(uploadMirrors, setUploadMirrors, QString)
+    CONFIG_GETTER_SETTER(s3Endpoint, setS3Endpoint, QString)
+    CONFIG_GETTER_SETTER(s3Region, setS3Region, QString)
+    CONFIG_GETTER_SETTER(s3Bucket, setS3Bucket, QString)
+    CONFIG_GETTER_SETTER(s3AccessKey, setS3AccessKey, QString)
+    CONFIG_GETTER_SETTER(s3SecretKey, setS3SecretKey, QString)
+    CONFIG_GETTER_SETTER(s3PathStyle, setS3PathStyle, bool)
+    CONFIG_GETTER_SETTER(s3PublicUrl, setS3PublicUrl, QString)
+    CONFIG_GETTER_SETTER(s3PartSize, setS3PartSize, int)
+    CONFIG_GETTER_SETTER(s3PartConcurrency, setS3PartConcurrency, int)
 
     // DEFAULTS
     QString filenamePatternDefault();
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef TASK_H
+#define TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace Flowshot {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+// Hands control back to whoever awaits the task, if anyone does
+struct FinalAwaiter
+{
+    bool await_ready() noexcept { return false; }
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        auto& promise = handle.promise();
+        if (promise.m_continuation) {
+            return promise.m_continuation;
+        }
+        // Nobody holds the task anymore, nobody else will free the frame
+        if (promise.m_detached) {
+            handle.destroy();
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+};
+
+class TaskPromiseBase
+{
+public:
+    // Tasks start right away, so starting two and awaiting both runs them concurrently
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { m_exception = std::current_exception(); }
+
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_exception;
+    bool m_detached = false;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object();
+    void return_value(T value) { m_value.emplace(std::move(value)); }
+
+    std::optional<T> m_value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object();
+    void return_void() {}
+};
+
+} // namespace detail
+
+/**
+ * @brief A coroutine that runs on the thread it was started on.
+ *
+ * The coroutine starts eagerly and runs until its first `co_await`. Awaiting
+ * the task, from another coroutine, resumes the awaiter once it is done and
+ * yields its result. A task that is dropped unfinished keeps running and
+ * frees itself at the end, so fire-and-forget is just not keeping the
+ * result; an exception of such a task is lost.
+ *
+ * The awaiters in Awaitables.h resume on the thread that awaits, which keeps
+ * a coroutine started on the GUI thread on the GUI thread throughout.
+ */
+template<typename T>
+class Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle)
+      : m_handle(handle)
+    {
+    }
+
+    Task(Task&& other) noexcept
+      : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { release(); }
+
+    bool isDone() const { return !m_handle || m_handle.done(); }
+
+    // Awaited at most once
+    bool await_ready() const noexcept { return m_handle.done(); }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept { m_handle.promise().m_continuation = awaiting; }
+
+    T await_resume()
+    {
+        promise_type& promise = m_handle.promise();
+        if (promise.m_exception) {
+            std::rethrow_exception(promise.m_exception);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*promise.m_value);
+        }
+    }
+
+private:
+    void release()
+    {
+        if (!m_handle) {
+            return;
+        }
+        if (m_handle.done()) {
+            m_handle.destroy();
+        } else {
+            m_handle.promise().m_detached = true;
+        }
+        m_handle = {};
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+} // namespace Flowshot
+
+#endif // TASK_H
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#include "EndpointsCache.h"
+#include "../Awaitables.h"
+#include "../ConfigHandler.h"
+#include "../abstractlogger.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+// Used when the server doesn't say how long the document stays fresh
+static constexpr qint64 ENDPOINTS_DEFAULT_TTL = 3600;
+// A forced refresh reuses a document this young, and a failure is
+// remembered this long
+static constexpr qint64 ENDPOINTS_MIN_REFRESH = 60;
+static constexpr int ENDPOINTS_TIMEOUT_MS = 10 * 1000;
+// A server that keeps trickling bytes never trips the transfer timeout
+static constexpr int ENDPOINTS_DEADLINE_MS = 30 * 1000;
+
+EndpointsCache::EndpointsCache()
+  : QObject(nullptr)
+  , m_NetworkAM(new QNetworkAccessManager(this))
+{
+    moveToThread(QCoreApplication::instance()->thread());
+
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(dir);
+    m_path = dir + QStringLiteral("/endpoints.json");
+    load();
+}
+
+EndpointsCache* EndpointsCache::instance()
+{
+    static EndpointsCache* cache = new EndpointsCache();
+    return cache;
+}
+
+void EndpointsCache::fetch(bool refresh)
+{
+    QMetaObject::invokeMethod(this, [this, refresh]() {
+        QString url = ConfigHandler().serverTPU() + "/endpoints.json";
+        if (url != m_url) {
+            // Another server, nothing we have applies
+            m_document.clear();
+            m_etag.clear();
+            m_lastModified.clear();
+            m_lastFailure.invalidate();
+        }
+
+        qint64 age = QDateTime::currentSecsSinceEpoch() - m_fetchedAt;
+        qint64 ttl = refresh ? qMin(m_maxAge, ENDPOINTS_MIN_REFRESH) : m_maxAge;
+        if (!m_document.isEmpty() && age < ttl) {
+            emit fetched(m_document);
+            return;
+        }
+        if (m_lastFailure.isValid() && m_lastFailure.elapsed() < ENDPOINTS_MIN_REFRESH * 1000) {
+            if (m_document.isEmpty()) {
+                emit failed(m_lastError);
+            } else {
+                emit fetched(m_document);
+            }
+            return;
+        }
+        // Whoever asked meanwhile gets the answer of the running request
+        if (!m_reply) {
+            request(url);
+        }
+    }, Qt::QueuedConnection);
+}
+
+// `url` is a copy, the coroutine outlives the caller's string
+Flowshot::Task<> EndpointsCache::request(QString url)
+{
+    QNetworkRequest request{ QUrl(url) };
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setTransferTimeout(ENDPOINTS_TIMEOUT_MS);
+    if (url == m_url && !m_document.isEmpty()) {
+        if (!m_etag.isEmpty()) {
+            request.setRawHeader("If-None-Match", m_etag);
+        }
+        if (!m_lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", m_lastModified);
+        }
+    }
+    AbstractLogger::info() << "Requesting URL: " << url;
+
+    m_reply = m_NetworkAM->get(request);
+    QNetworkReply* reply = co_await Flowshot::awaitReply(m_reply, ENDPOINTS_DEADLINE_MS);
+    m_reply = nullptr;
+    reply->deleteLater();
+    handleReply(reply, url);
+}
+
+void EndpointsCache::handleReply(QNetworkReply* reply, const QString& url)
+{
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError && status != 304) {
+        m_lastError = reply->errorString();
+        m_lastFailure.start();
+        AbstractLogger::error() << "Endpoint discovery failed: " << m_lastError;
+        if (m_document.isEmpty()) {
+            emit failed(m_lastError);
+        } else {
+            AbstractLogger::warning() << "Using the cached endpoints.json";
+            emit fetched(m_document);
+        }
+        return;
+    }
+
+    if (status != 304) {
+        m_document = reply->readAll();
+        m_etag = reply->rawHeader("ETag");
+        m_lastModified = reply->rawHeader("Last-Modified");
+        m_url = url;
+    }
+    m_fetchedAt = QDateTime::currentSecsSinceEpoch();
+    m_lastFailure.invalidate();
+
+    static const QRegularExpression maxAge(QStringLiteral("max-age=(\\d+)"));
+    QRegularExpressionMatch match = maxAge.match(QString::fromLatin1(reply->rawHeader("Cache-Control")));
+    m_maxAge = match.hasMatch() ? match.captured(1).toLongLong() : ENDPOINTS_DEFAULT_TTL;
+
+    save();
+    emit fetched(m_document);
+}
+
+void EndpointsCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    m_url = json[QStringLiteral("url")].toString();
+    m_document = json[QStringLiteral("document")].toString().toUtf8();
+    m_etag = json[QStringLiteral("etag")].toString().toLatin1();
+    m_lastModified = json[QStringLiteral("lastModified")].toString().toLatin1();
+    m_fetchedAt = json[QStringLiteral("fetchedAt")].toInteger();
+    m_maxAge = json[QStringLiteral("maxAge")].toInteger(ENDPOINTS_DEFAULT_TTL);
+}
+
+void EndpointsCache::save() const
+{
+    QJsonObject json{ { QStringLiteral("url"), m_url },
+                      { QStringLiteral("document"), QString::fromUtf8(m_document) },
+                      { QStringLiteral("etag"), QString::fromLatin1(m_etag) },
+                      { QStringLiteral("lastModified"), QString::fromLatin1(m_lastModified) },
+                      { QStringLiteral("fetchedAt"), m_fetchedAt },
+                      { QStringLiteral("maxAge"), m_maxAge } };
+
+    QSaveFile file(m_path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
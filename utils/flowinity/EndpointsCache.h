@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 Troplo & Contributors
+
+#ifndef FLOWSHOT_ENDPOINTSCACHE_H
+#define FLOWSHOT_ENDPOINTSCACHE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+
+#include "../Task.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+ * @brief The one copy of endpoints.json shared by the whole process.
+ *
+ * A fetched document is served from memory (and from the cache directory,
+ * across processes) until it is older than its max-age, or an hour. After
+ * that it is revalidated with If-None-Match / If-Modified-Since, so an
+ * unchanged document costs a 304. A forced refresh still reuses a document
+ * younger than a minute, and a failed fetch isn't repeated for a minute
+ * either. Concurrent fetches share one in-flight request.
+ *
+ * When the server can't be reached, a stale document is served rather than
+ * none. Lives on the main thread; `fetch()` may be called from any thread.
+ */
+class EndpointsCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static EndpointsCache* instance();
+
+    // Answered with exactly one of fetched() or failed()
+    void fetch(bool refresh);
+
+signals:
+    void fetched(QByteArray document);
+    void failed(QString error);
+
+private:
+    explicit EndpointsCache();
+
+    Flowshot::Task<> request(QString url);
+    void handleReply(QNetworkReply* reply, const QString& url);
+    void load();
+    void save() const;
+
+    QNetworkAccessManager* m_NetworkAM;
+    QNetworkReply* m_reply = nullptr;
+    QString m_path;
+
+    QString m_url;
+    QByteArray m_document;
+    QByteArray m_etag;
+    QByteArray m_lastModified;
+    qint64 m_fetchedAt = 0; // s since epoch
+    qint64 m_maxAge = 0; // s
+
+    QString m_lastError;
+    QElapsedTimer m_lastFailure;
+};
+
+#endif // FLOWSHOT_ENDPOINTSCACHE_H
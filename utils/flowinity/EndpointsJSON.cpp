@@ -3,18 +3,18 @@
 //
 
 #include "EndpointsJSON.h"
+#include "EndpointsCache.h"
 #include "../ConfigHandler.h"
 #include "../abstractlogger.h"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QNetworkReply>
-#include <QNetworkRequest>
+#include <QSharedPointer>
+#include <QStringList>
 #include <QtGlobal>
 
 EndpointsJSON::EndpointsJSON(QObject* parent)
         : QObject(parent)
-        , m_NetworkAM(new QNetworkAccessManager(this))
 {}
 
 void EndpointsJSON::getAPIFromEndpoints(bool refresh)
@@ -27,38 +27,45 @@ void EndpointsJSON::getAPIFromEndpoints(bool refresh)
         }
     }
 
-    const QString tpuUrl = ConfigHandler().serverTPU();
-    const QString endpointPrimary = tpuUrl + "/endpoints.json";
-
-    QNetworkRequest requestPrimary;
-    requestPrimary.setUrl(QUrl(endpointPrimary));
-    requestPrimary.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    AbstractLogger::info() << "Requesting URL: " << endpointPrimary;
-
-    QNetworkReply* replyPrimary = m_NetworkAM->get(requestPrimary);
-
-    connect(replyPrimary, &QNetworkReply::finished, this, [this, replyPrimary]() {
-        AbstractLogger::info() << "Primary endpoint request finished";
-        if (replyPrimary->error() == QNetworkReply::NoError) {
-            handleAPIEndpointResponse(replyPrimary);
-        } else {
-            AbstractLogger::error() << "Primary endpoint request failed: " << replyPrimary->errorString();
-            emit error(replyPrimary->errorString());
+    // The cache answers every listener, only take the next answer
+    EndpointsCache* cache = EndpointsCache::instance();
+    auto connections = QSharedPointer<QList<QMetaObject::Connection>>::create();
+    auto disconnectAll = [connections]() {
+        for (const QMetaObject::Connection& connection : std::as_const(*connections)) {
+            QObject::disconnect(connection);
         }
-        replyPrimary->deleteLater();
-    });
+    };
+    connections->append(connect(cache, &EndpointsCache::fetched, this, [this, disconnectAll](QByteArray document) {
+        disconnectAll();
+        handleAPIEndpointResponse(document);
+    }));
+    connections->append(connect(cache, &EndpointsCache::failed, this, [this, disconnectAll](QString message) {
+        disconnectAll();
+        emit error(message);
+    }));
+    cache->fetch(refresh);
 }
 
-void EndpointsJSON::handleAPIEndpointResponse(QNetworkReply* reply)
+void EndpointsJSON::handleAPIEndpointResponse(const QByteArray& document)
 {
     QJsonParseError jsonError;
-    QJsonDocument const json = QJsonDocument::fromJson(reply->readAll(), &jsonError);
+    QJsonDocument const json = QJsonDocument::fromJson(document, &jsonError);
     if (jsonError.error != QJsonParseError::NoError) {
         emit error(jsonError.errorString());
         return;
     }
 
-    QString response = json.object().value("api").toArray().at(0).toObject().value("url").toString();
+    // Uploads are balanced over all of them, the first stays the default
+    QStringList urls;
+    for (const QJsonValue& api : json.object().value("api").toArray()) {
+        QString url = api.toObject().value("url").toString();
+        if (!url.isEmpty()) {
+            urls.append(url);
+        }
+    }
+    ConfigHandler().setServerAPIEndpointList(urls.join(' '));
+
+    QString response = urls.value(0);
     if (!response.isEmpty()) {
         emit endpointOk(response);
     } else {
@@ -74,6 +81,7 @@ void EndpointsJSON::getAPIEndpoint(bool refresh) {
 
         const QString fallbackEndpoint = ConfigHandler().serverTPU() + "/api/v3";
         ConfigHandler().setServerAPIEndpoint(fallbackEndpoint);
+        ConfigHandler().setServerAPIEndpointList(QString());
         ConfigHandler().setServerSupportsEndpoints(false);
         emit endpointOk(fallbackEndpoint);
     });
@@ -2,7 +2,7 @@
 // Created by troplo on 6/10/24.
 //
 
-#include <QNetworkAccessManager>
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 
@@ -24,8 +24,7 @@ signals:
     void error(QString error);
 
 private:
-    QNetworkAccessManager* m_NetworkAM;
-    void handleAPIEndpointResponse(QNetworkReply* reply);
+    void handleAPIEndpointResponse(const QByteArray& document);
 };
 
 